@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+
+#
+#  This file is part of MADNESS.
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation; either version 2 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software
+#  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+#
+
+"""Compares two benchmark result files written by the madness-benchmarks programs.
+
+    compare_benchmarks.py [--threshold=0.1] [--all] baseline.json new.json
+
+Benchmarks are matched by suite and name and compared by their minimum
+time, and recorded memory by its size in bytes.  A benchmark that got
+slower, or used more memory, by more than the threshold (a fraction,
+default 10%) is a regression, and then the exit status is 1.  Benchmarks
+in only one of the files are listed but not counted as regressions.
+"""
+
+import json
+import sys
+
+
+def load(filename):
+    with open(filename) as f:
+        data = json.load(f)
+    # A file may hold one suite or a list of suites
+    suites = data if isinstance(data, list) else [data]
+    results = {}
+    for suite in suites:
+        for b in suite["benchmarks"]:
+            results[(suite["suite"], b["name"])] = b["min"]
+        for m in suite.get("memory", []):
+            results[(suite["suite"], m["name"] + " [bytes]")] = m["bytes"]
+    return results
+
+
+def main(argv):
+    threshold = 0.1
+    show_all = False
+    files = []
+    for arg in argv[1:]:
+        if arg.startswith("--threshold="):
+            threshold = float(arg[len("--threshold="):])
+        elif arg == "--all":
+            show_all = True
+        elif arg.startswith("-"):
+            print(__doc__)
+            return 2
+        else:
+            files.append(arg)
+    if len(files) != 2:
+        print(__doc__)
+        return 2
+
+    old = load(files[0])
+    new = load(files[1])
+
+    nregress = nimprove = 0
+    print("%-60s %12s %12s %8s" % ("benchmark", "old", "new", "change"))
+    for key in sorted(set(old) | set(new)):
+        name = "%s: %s" % key
+        if key not in new:
+            print("%-60s %12.4e %12s" % (name, old[key], "missing"))
+            continue
+        if key not in old:
+            print("%-60s %12s %12.4e" % (name, "missing", new[key]))
+            continue
+        told, tnew = old[key], new[key]
+        change = (tnew - told)/told if told > 0 else 0.0
+        flag = ""
+        if change > threshold:
+            flag = "REGRESSION"
+            nregress += 1
+        elif change < -threshold:
+            flag = "improved"
+            nimprove += 1
+        if flag or show_all:
+            print("%-60s %12.4e %12.4e %+7.1f%% %s" % (name, told, tnew, 100.0*change, flag))
+
+    print("\n%d regressions and %d improvements beyond %.0f%%" % (nregress, nimprove, 100.0*threshold))
+    return 1 if nregress else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,10 @@
+macro(add_benchmarks _component _sources _libs)
+
+  # Benchmark executables are built by the madness-benchmarks target
+  foreach(_source ${_sources})
+    get_filename_component(_bench "${_source}" NAME_WE)
+    add_mad_executable(${_bench} "${_source}" "${_libs}")
+    add_dependencies(madness-benchmarks ${_bench})
+  endforeach()
+
+endmacro()
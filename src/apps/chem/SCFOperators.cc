@@ -399,8 +399,7 @@ std::vector<Function<T, NDIM> > Exchange<T, NDIM>::operator()(
     if (small_memory_) {     // Smaller memory algorithm ... possible 2x saving using i-j sym
         for (int i = 0; i < nocc; ++i) {
             if (occ[i] > 0.0) {
-                vecfuncT psif = mul_sparse(world, mo_bra[i], vket, mul_tol); /// was vtol
-                truncate(world, psif);
+                vecfuncT psif = mul_sparse(world, mo_bra[i], vket, mul_tol, true, true); /// was vtol
                 psif = apply(world, *poisson.get(), psif);
                 truncate(world, psif);
                 psif = mul_sparse(world, mo_ket[i], psif, mul_tol); /// was vtol
@@ -1144,7 +1144,7 @@ vector<CC_vecfunction> TDHF::make_guess_from_initial_diagonalization() const {
     {
         Tensor<double> U, evals;
         CCTimer time_diag(world, "cis-matrix diagonalization");
-        syev(MCIS, U, evals);
+        syevp(world, MCIS, U, evals);
         time_diag.print();
 
         if (parameters.debug()) {
@@ -69,6 +69,12 @@ public:
 
     std::string symbol() const {return symbol_;}
 
+    /// return the mirror map: -1 for reflected dimensions (empty for identity and inversion)
+    const std::vector<long>& get_mirrormap() const {return mirrormap;}
+
+    /// return the dimension map (empty if the dimensions are not permuted)
+    const std::vector<long>& get_mapdim() const {return mapdim_;}
+
 	/// apply the operator on an n-dimensional MRA function
 	template<typename T, std::size_t NDIM>
 	Function<T,NDIM> operator()(const Function<T,NDIM>& f, bool fence=true) const {
@@ -65,6 +65,7 @@
 
 #include <madness/world/MADworld.h>
 #include <chem/pointgroupoperator.h>
+#include <madness/mra/mirror_symmetry.h>
 
 using namespace madness;
 
@@ -191,6 +192,27 @@ public:
 		return table_.mullikan_;
 	}
 
+	/// return the reflections of the point group with the characters of an irrep
+
+	/// Functions of this irrep can be passed to apply() with the result,
+	/// which then computes only the irreducible boxes.
+	MirrorSymmetry<3> get_mirror_symmetry(std::string irrep) const {
+        std::transform(irrep.begin(), irrep.end(), irrep.begin(), ::tolower);
+		auto characters=table_.irreps_.find(irrep);
+		if (characters==table_.irreps_.end()) MADNESS_EXCEPTION("no such irrep in this point group",1);
+
+		MirrorSymmetry<3> symmetry;
+		for (size_t i=0; i<table_.operators_.size(); ++i) {
+			const pg_operator& op=table_.operators_[i];
+			if (op.name()=="identity") continue;
+			MADNESS_CHECK(op.get_mapdim().size()==0);
+			std::vector<long> mm=op.get_mirrormap();
+			if (op.name()=="inversion") mm=std::vector<long>(3,-1);
+			symmetry.add(mm,characters->second[i]);
+		}
+		return symmetry;
+	}
+
 	/// projector on a given irrep
 
 	/// @return	a vector[irreps] of a vector of functions
@@ -231,17 +231,54 @@ typedef Convolution1D<double_complex> complex_operatorT;
         template <typename Archive> void serialize(Archive& ar) {}
     };
 
-complex_functionT APPLY(const complex_operatorT* q1d, const complex_functionT& psi) {
+    /// Refines where the tree of a hint function has children
+    struct hintop {
+        const FunctionImpl<double_complex,3>* hint;
+
+        hintop() : hint(0) {}
+        hintop(const FunctionImpl<double_complex,3>* hint) : hint(hint) {}
+
+        bool operator()(FunctionImpl<double_complex,3>* impl, const Key<3>& key, const FunctionNode<double_complex,3>& t) const {
+            // Same process map, so the hint node is local if it exists
+            if (!hint->get_coeffs().probe(key)) return false;
+            return hint->get_coeffs().find(key).get()->second.has_children();
+        }
+        template <typename Archive> void serialize(Archive& ar) {
+            MADNESS_EXCEPTION("hintop is local only",0);
+        }
+    };
+
+// Applies the free-particle propagator along each axis in turn.
+//
+// The input is refined so the result can widen. Without a hint it is
+// broadened four times. A hint is the truncated result of the same
+// application in the previous step. The input is refined to the hint's
+// tree, which is a local operation, and then broadened only twice. The
+// tree changes little between steps, so this gives the same result.
+complex_functionT APPLY(const complex_operatorT* q1d, const complex_functionT& psi,
+                        const complex_functionT& hint = complex_functionT()) {
     complex_functionT r = psi;  // Shallow copy violates constness !!!!!!!!!!!!!!!!!
     coordT lo, hi;
     lo[2] = -10;
     hi[2] = +10;
 
     r.reconstruct();
-    r.broaden();
-    r.broaden();
-    r.broaden();
-    r.broaden();
+    if (hint.is_initialized() && hint.get_pmap() == r.get_pmap()) {
+        hint.reconstruct();
+        for (int n=0; n<10; ++n) {  // One level per pass
+            std::size_t tree_size = r.tree_size();
+            r.refine_general(hintop(hint.get_impl().get()));
+            if (r.tree_size() == tree_size) break;
+        }
+        r.broaden();
+        r.broaden();
+    }
+    else {
+        r.broaden();
+        r.broaden();
+        r.broaden();
+        r.broaden();
+    }
 
     r = apply_1d_realspace_push(*q1d, r, 2); r.sum_down();
     r = apply_1d_realspace_push(*q1d, r, 1); r.sum_down();
@@ -487,11 +524,14 @@ void converge2s(World& world, functionT& potn, functionT& psi, double& eps) {
     }
 }
 
+// hints[i] holds the truncated result of the i-th application of G in
+// the previous step and is updated for the next one
 complex_functionT chin_chen(const complex_functionT& expV_0,
                             const complex_functionT& expV_tilde,
                             const complex_functionT& expV_1,
                             const complex_operatorT* G,
-                            const complex_functionT& psi0) {
+                            const complex_functionT& psi0,
+                            std::vector<complex_functionT>& hints) {
     // psi(t) = exp(-i*V(t)*t/6) exp(-i*T*t/2) exp(-i*2*Vtilde(t/2)*t/3) exp(-i*T*t/2) exp(-i*V(0)*t/6)
     // .             expV_1            G               expV_tilde             G             expV_0
 
@@ -500,13 +540,13 @@ complex_functionT chin_chen(const complex_functionT& expV_0,
     double t0 = wall_time();
     psi1 = expV_0*psi0;     psi1.truncate();
     double t1 = wall_time();
-    psi1 = APPLY(G,psi1);   psi1.truncate();
+    psi1 = APPLY(G,psi1,hints[0]);   psi1.truncate();   hints[0] = psi1;
 
     double t2 = wall_time();
     psi1 = expV_tilde*psi1; psi1.truncate();
     double t3 = wall_time();
 
-    psi1 = APPLY(G,psi1);   psi1.truncate();
+    psi1 = APPLY(G,psi1,hints[1]);   psi1.truncate();   hints[1] = psi1;
     double t4 = wall_time();
     psi1 = expV_1*psi1;     psi1.truncate(param.thresh);
     double t5 = wall_time();
@@ -518,21 +558,23 @@ complex_functionT chin_chen(const complex_functionT& expV_0,
     return psi1;
 }
 
+// hints as for chin_chen
 complex_functionT trotter(World& world,
                           const complex_functionT& expV,
                           const complex_operatorT* G,
-                          const complex_functionT& psi0) {
+                          const complex_functionT& psi0,
+                          std::vector<complex_functionT>& hints) {
     //    psi(t) = exp(-i*T*t/2) exp(-i*V(t/2)*t) exp(-i*T*t/2) psi(0)
 
     complex_functionT psi1;
 
     unsigned long size = psi0.size();
     if (world.rank() == 0) print("APPLYING G", size);
-    psi1 = APPLY(G,psi0);  psi1.truncate();  size = psi1.size();
+    psi1 = APPLY(G,psi0,hints[0]);  psi1.truncate();  size = psi1.size();  hints[0] = psi1;
     if (world.rank() == 0) print("APPLYING expV", size);
     psi1 = expV*psi1;      psi1.truncate();  size = psi1.size();
     if (world.rank() == 0) print("APPLYING G again", size);
-    psi1 = APPLY(G,psi1);  psi1.truncate(param.thresh);  size = psi1.size();
+    psi1 = APPLY(G,psi1,hints[1]);  psi1.truncate(param.thresh);  size = psi1.size();  hints[1] = psi1;
     if (world.rank() == 0) print("DONE", size);
 
     return psi1;
@@ -611,14 +653,13 @@ const char* wave_function_large_plot_filename(int step) {
 
 complex_functionT wave_function_load(World& world, int step) {
     complex_functionT psi;
-    archive::ParallelInputArchive ar(world, wave_function_filename(step));
-    ar & psi;
+    load_checkpoint(world, psi, wave_function_filename(step));
     return psi;
 }
 
-void wave_function_store(World& world, int step, const complex_functionT& psi) {
-    archive::ParallelOutputArchive ar(world, wave_function_filename(step), param.nio);
-    ar & psi;
+// Starts writing psi in the background; the previous dump is completed first
+void wave_function_store(CheckpointWriter& checkpoint, int step, const complex_functionT& psi) {
+    checkpoint.save(psi, wave_function_filename(step));
 }
 
 bool wave_function_exists(World& world, int step) {
@@ -815,6 +856,9 @@ void propagate(World& world, int step0) {
     psi.truncate();
 
     bool use_trotter = false;
+    CheckpointWriter checkpoint(world);
+    int dumped = -1;    // The last step written by checkpoint
+    std::vector<complex_functionT> hints(2); // Trees of the last applications of G
     while (step < nstep) {
         double t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13;
         t0 = wall_time();
@@ -829,7 +873,7 @@ void propagate(World& world, int step0) {
 
             // Apply Trotter to advance from time t to time t+step
             complex_functionT expV = make_exp(time_step, vhalf);
-            psi = trotter(world, expV, G, psi);
+            psi = trotter(world, expV, G, psi, hints);
         }
         else { // Chin-Chen
             // Make z-component of del V at time tstep/2
@@ -872,7 +916,7 @@ void propagate(World& world, int step0) {
             t9 = wall_time();
 
             // Apply Chin-Chen
-            psi = chin_chen(expv_0, expv_tilde, expv_1, G, psi);
+            psi = chin_chen(expv_0, expv_tilde, expv_1, G, psi, hints);
             t10 = wall_time();
         }
 
@@ -903,13 +947,14 @@ void propagate(World& world, int step0) {
 
         if ((step%param.ndump) == 0 || step==nstep) {
             double start = wall_time();
-            wave_function_store(world, step, psi);
-            // Update the restart file for automatic restarting
-            if (world.rank() == 0) {
-                std::ofstream("restart") << step << std::endl;
-                print("dumping took", wall_time()-start);
-            }
+            // Update the restart file for automatic restarting once the
+            // previous dump is on disk on all processes
+            checkpoint.wait();
             world.gop.fence();
+            if (world.rank() == 0 && dumped >= 0) std::ofstream("restart") << dumped << std::endl;
+            wave_function_store(checkpoint, step, psi);
+            dumped = step;
+            if (world.rank() == 0) print("dumping took", wall_time()-start);
         }
 
         if ((step%param.nplot) == 0 || step==nstep) {
@@ -917,6 +962,10 @@ void propagate(World& world, int step0) {
             doplot(world, step, psi, param.Llarge, 201, wave_function_large_plot_filename(step));
         }
     }
+
+    checkpoint.wait();
+    world.gop.fence();
+    if (world.rank() == 0 && dumped >= 0) std::ofstream("restart") << dumped << std::endl;
 }
 
 void doit(World& world) {
@@ -1008,7 +1057,9 @@ void doit(World& world) {
                 iState = psi2s;
             }
             complex_functionT iStateC = double_complex(1.0,0.0)*iState;
-            wave_function_store(world, 0, iStateC);
+            CheckpointWriter checkpoint(world);
+            wave_function_store(checkpoint, 0, iStateC);
+            checkpoint.wait();
         }
         else {
             if (world.rank() == 0) {
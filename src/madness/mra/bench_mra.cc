@@ -0,0 +1,204 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+
+/// \file bench_mra.cc
+/// \brief Benchmarks of the integral operator kernel and of whole-function operations
+
+/// The operations on functions use a model density of Gaussians centered
+/// on the atoms of a few reference molecules, and the 6D pair functions are
+/// Hartree products of such a model orbital with itself.  Run with
+/// \c --json=file to keep the results and \c --quick to only check that
+/// the benchmarks run.
+
+#include <madness/mra/mra.h>
+#include <madness/mra/operator.h>
+#include <madness/world/benchmark.h>
+#include <string>
+#include <vector>
+
+using namespace madness;
+
+/// A reference molecule ... coordinates in bohr and Gaussian exponents
+struct ReferenceMolecule {
+    std::string name;
+    std::vector<coord_3d> centers;
+    std::vector<double> exponents;
+};
+
+std::vector<ReferenceMolecule> reference_molecules() {
+    ReferenceMolecule he = {"he", {{0.0, 0.0, 0.0}}, {2.0}};
+    ReferenceMolecule h2o = {"h2o",
+        {{0.0, 0.0, 0.2217}, {0.0, 1.4309, -0.8867}, {0.0, -1.4309, -0.8867}},
+        {8.0, 1.0, 1.0}};
+    ReferenceMolecule ch4 = {"ch4",
+        {{0.0, 0.0, 0.0}, {1.1860, 1.1860, 1.1860}, {-1.1860, -1.1860, 1.1860},
+         {-1.1860, 1.1860, -1.1860}, {1.1860, -1.1860, -1.1860}},
+        {6.0, 1.0, 1.0, 1.0, 1.0}};
+    return {he, h2o, ch4};
+}
+
+/// Sum of normalized Gaussians, one per atom
+class ModelDensity : public FunctionFunctorInterface<double,3> {
+    const ReferenceMolecule mol;
+public:
+    ModelDensity(const ReferenceMolecule& mol) : mol(mol) {}
+
+    double operator()(const coord_3d& r) const {
+        double sum = 0.0;
+        for (std::size_t i=0; i<mol.centers.size(); ++i) {
+            const double a = mol.exponents[i];
+            const double rsq = (r - mol.centers[i]).normf()*(r - mol.centers[i]).normf();
+            sum += std::pow(a/constants::pi, 1.5)*std::exp(-a*rsq);
+        }
+        return sum;
+    }
+
+    std::vector<coord_3d> special_points() const {return mol.centers;}
+};
+
+/// The operator kernel on one block of coefficients, by displacement
+void bench_operator_kernel(World& world, BenchmarkRecorder& bench, const SeparatedConvolution<double,3>& op) {
+    const int k = FunctionDefaults<3>::get_k();
+    const Level n = 4;
+    const Key<3> source(n, Vector<Translation,3>(1l << (n-1)));
+    Tensor<double> coeff(2*k, 2*k, 2*k);
+    coeff.fillrandom();
+
+    const std::vector< Vector<Translation,3> > shifts = {
+        {0,0,0}, {1,0,0}, {1,1,0}, {1,1,1}, {2,0,0}, {4,0,0}};
+    const long niter = bench.quick() ? 1 : 10;
+    for (const Vector<Translation,3>& l : shifts) {
+        const Key<3> shift(n, l);
+        std::string name = "operator apply k=" + std::to_string(k) + " shift=";
+        for (int d=0; d<3; ++d) name += (d ? "," : "") + std::to_string(l[d]);
+        bench.run(name, [&] {
+            for (long i=0; i<niter; ++i) op.apply(source, shift, coeff, 1e-12);
+        }, 10, niter, "block");
+    }
+}
+
+/// compress, reconstruct, truncate and the Coulomb operator on a model density
+void bench_functions(World& world, BenchmarkRecorder& bench, const SeparatedConvolution<double,3>& op,
+                     const ReferenceMolecule& mol) {
+    const std::string suffix = " " + mol.name + " k=" + std::to_string(FunctionDefaults<3>::get_k());
+    const long nrep = bench.reps(5);
+    std::vector<double> tcompress, treconstruct, ttruncate, tapply;
+    real_function_3d f = real_factory_3d(world).functor(
+        std::shared_ptr< FunctionFunctorInterface<double,3> >(new ModelDensity(mol)));
+
+    for (long rep=0; rep<=nrep; ++rep) {
+        world.gop.fence();
+        double start = wall_time();
+        f.compress();
+        const double t1 = wall_time();
+        f.reconstruct();
+        const double t2 = wall_time();
+        real_function_3d g = copy(f);
+        world.gop.fence();
+        const double t3 = wall_time();
+        g.truncate();
+        const double t4 = wall_time();
+        real_function_3d v = apply(op, g);
+        const double t5 = wall_time();
+
+        // the first repetition is a warm-up
+        if (rep > 0) {
+            tcompress.push_back(t1 - start);
+            treconstruct.push_back(t2 - t1);
+            ttruncate.push_back(t4 - t3);
+            tapply.push_back(t5 - t4);
+        }
+        if (rep == nrep) {
+            const std::size_t nf = f.tree_size(), ng = g.tree_size(), nv = v.tree_size();
+            if (world.rank() == 0) print("   ", mol.name, "boxes", nf, "truncated", ng, "potential", nv);
+        }
+    }
+    bench.add("compress" + suffix, tcompress);
+    bench.add("reconstruct" + suffix, treconstruct);
+    bench.add("truncate" + suffix, ttruncate);
+    bench.add("coulomb apply" + suffix, tapply);
+}
+
+/// Construction of a 6D pair function by the Hartree product of a model orbital with itself
+void bench_hartree(World& world, BenchmarkRecorder& bench, const ReferenceMolecule& mol) {
+    const int k = bench.quick() ? 4 : 6;
+    const double thresh = bench.quick() ? 1e-2 : 1e-3;
+    FunctionDefaults<6>::set_cubic_cell(-20, 20);
+    FunctionDefaults<6>::set_thresh(thresh);
+    FunctionDefaults<6>::set_k(k);
+
+    real_function_3d phi = real_factory_3d(world).k(k).thresh(thresh).functor(
+        std::shared_ptr< FunctionFunctorInterface<double,3> >(new ModelDensity(mol)));
+    const std::string name = "hartree_product " + mol.name + " k=" + std::to_string(k);
+    const long nrep = bench.reps(3);
+    std::vector<double> times;
+    std::size_t nbox = 0, ncoeff = 0;
+    for (long rep=0; rep<=nrep; ++rep) {
+        world.gop.fence();
+        const double start = wall_time();
+        real_function_6d pair = hartree_product(phi, phi);
+        const double t = wall_time() - start;
+
+        // the first repetition is a warm-up
+        if (rep > 0) times.push_back(t);
+        if (rep == nrep) {
+            nbox = pair.tree_size();
+            ncoeff = pair.size();
+        }
+    }
+    bench.add(name, times, nbox, "box");
+    bench.memory(name, double(ncoeff)*sizeof(double));
+}
+
+int main(int argc, char** argv) {
+    World& world = initialize(argc, argv);
+    startup(world, argc, argv);
+    {
+        BenchmarkRecorder bench(world, "mra", argc, argv);
+        const double thresh = bench.quick() ? 1e-4 : 1e-6;
+        FunctionDefaults<3>::set_cubic_cell(-20, 20);
+        FunctionDefaults<3>::set_thresh(thresh);
+        FunctionDefaults<3>::set_k(bench.quick() ? 6 : 8);
+
+        SeparatedConvolution<double,3> op = CoulombOperator(world, 1e-4, thresh);
+        bench_operator_kernel(world, bench, op);
+        for (const ReferenceMolecule& mol : reference_molecules()) bench_functions(world, bench, op, mol);
+        for (const ReferenceMolecule& mol : reference_molecules()) {
+            if (mol.name == "he" || mol.name == "h2o") bench_hartree(world, bench, mol);
+        }
+
+        bench.write();
+        world.gop.fence();
+    }
+    finalize();
+    return 0;
+}
@@ -0,0 +1,313 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_MRA_CHECKPOINT_H__INCLUDED
+#define MADNESS_MRA_CHECKPOINT_H__INCLUDED
+
+/// \file checkpoint.h
+/// \brief Checkpointing of functions with the disk I/O done in the background
+
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <madness/world/binary_fstream_archive.h>
+#include <madness/world/vector_archive.h>
+#include <madness/world/nodefaults.h>
+
+namespace madness {
+
+    /// Writes checkpoints of functions to disk while computation continues
+
+    /// \c save() is collective.  After a fence each process takes a deep copy
+    /// of its local coefficients and returns; a separate I/O thread then
+    /// writes the copy to the file \c name.NNNNN of this process.  No
+    /// communication happens on the I/O thread.  The returned future is
+    /// assigned with the number of nodes written by this process once its
+    /// file is closed.
+    ///
+    /// A checkpoint is only started after the previous one has finished, so
+    /// at most one snapshot is held in memory.  If the local snapshot would
+    /// exceed the memory budget the coefficients are written synchronously
+    /// from the function itself, without a copy.
+    ///
+    /// Checkpoints are read back with \c load_checkpoint(), using any number
+    /// of processes.
+    /// \code
+    /// CheckpointWriter checkpoint(world);
+    /// for (int step=0; step<nstep; ++step) {
+    ///     propagate(psi);
+    ///     if (step%ndump == 0) checkpoint.save(psi, "psi");
+    /// }
+    /// checkpoint.wait();
+    /// \endcode
+    class CheckpointWriter : private NO_DEFAULTS {
+        World& world;
+        std::size_t max_bytes;          ///< Memory budget of a snapshot on this process
+        std::thread thread;             ///< I/O thread of the pending checkpoint
+        Future<std::size_t> pending;    ///< Completion of the pending checkpoint
+        std::exception_ptr error;       ///< Failure of the last I/O thread
+
+        /// Local coefficients and parameters of a set of functions
+        template <typename T, std::size_t NDIM>
+        struct Snapshot {
+            typedef std::pair<Key<NDIM>,FunctionNode<T,NDIM> > datumT;
+
+            std::vector< std::vector<unsigned char> > parameters;
+            std::vector< std::vector<datumT> > nodes;
+        };
+
+    public:
+        /// Magic number at the start of each checkpoint file
+        static const long magic = -7776768;
+
+        /// @param[in] world        the world of the functions
+        /// @param[in] max_bytes    memory budget of a snapshot on each process
+        explicit CheckpointWriter(World& world, std::size_t max_bytes=std::size_t(1)<<30)
+            : world(world)
+            , max_bytes(max_bytes)
+            , thread()
+            , pending(std::size_t(0))
+            , error() {}
+
+        ~CheckpointWriter() {
+            pending.get();
+            if (thread.joinable()) thread.join();
+        }
+
+        /// Returns the completion future of the last checkpoint on this process
+        const Future<std::size_t>& status() const {return pending;}
+
+        /// Waits for the last checkpoint to be written by this process
+
+        /// Rethrows any exception raised while writing.  Not collective.
+        void wait() {
+            pending.get();
+            if (thread.joinable()) thread.join();
+            if (error) {
+                std::exception_ptr e = error;
+                error = nullptr;
+                std::rethrow_exception(e);
+            }
+        }
+
+        /// Starts a checkpoint of a function; collective
+
+        /// @param[in] f    the function, in any tree state
+        /// @param[in] name the base name of the checkpoint files
+        /// @return future number of nodes written by this process
+        template <typename T, std::size_t NDIM>
+        Future<std::size_t> save(const Function<T,NDIM>& f, const std::string& name) {
+            return save(std::vector< Function<T,NDIM> >(1,f), name);
+        }
+
+        /// Starts a checkpoint of a vector of functions; collective
+
+        /// @param[in] v    the functions, in any tree state
+        /// @param[in] name the base name of the checkpoint files
+        /// @return future number of nodes written by this process
+        template <typename T, std::size_t NDIM>
+        Future<std::size_t> save(const std::vector< Function<T,NDIM> >& v, const std::string& name) {
+            typedef FunctionImpl<T,NDIM> implT;
+            typedef typename implT::dcT dcT;
+            typedef Snapshot<T,NDIM> snapshotT;
+
+            wait();
+            world.gop.fence();
+
+            std::size_t bytes = 0;
+            for (const auto& f : v) {
+                f.verify();
+                const dcT& coeffs = f.get_impl()->get_coeffs();
+                bytes += coeffs.size()*(sizeof(Key<NDIM>)+sizeof(FunctionNode<T,NDIM>));
+                for (auto it=coeffs.begin(); it!=coeffs.end(); ++it) {
+                    if (it->second.has_coeff()) bytes += it->second.coeff().real_size()*sizeof(T);
+                }
+            }
+
+            std::shared_ptr<snapshotT> snapshot(new snapshotT);
+            for (const auto& f : v) {
+                snapshot->parameters.push_back(std::vector<unsigned char>());
+                archive::VectorOutputArchive ar(snapshot->parameters.back(), 256);
+                f.get_impl()->store_parameters(ar);
+            }
+
+            const std::string filename = local_filename(name, world.rank());
+            const int nproc = world.size();
+
+            if (bytes > max_bytes) {
+                std::vector<const dcT*> coeffs;
+                for (const auto& f : v) coeffs.push_back(&f.get_impl()->get_coeffs());
+                pending = Future<std::size_t>(write(filename, nproc, *snapshot, coeffs));
+                return pending;
+            }
+
+            for (const auto& f : v) {
+                const dcT& coeffs = f.get_impl()->get_coeffs();
+                snapshot->nodes.push_back(std::vector<typename snapshotT::datumT>());
+                snapshot->nodes.back().reserve(coeffs.size());
+                for (auto it=coeffs.begin(); it!=coeffs.end(); ++it) {
+                    snapshot->nodes.back().push_back(*it);  // FunctionNode copies are deep
+                }
+            }
+
+            Future<std::size_t> result;
+            pending = result;
+            thread = std::thread([this, filename, nproc, snapshot, result]() mutable {
+                std::size_t count = 0;
+                try {
+                    std::vector<const std::vector<typename snapshotT::datumT>*> nodes;
+                    for (const auto& n : snapshot->nodes) nodes.push_back(&n);
+                    count = write(filename, nproc, *snapshot, nodes);
+                }
+                catch (...) {
+                    error = std::current_exception();
+                }
+                snapshot.reset();
+                result.set(count);
+            });
+            return result;
+        }
+
+        /// Returns the name of the file written by process \c p
+        static std::string local_filename(const std::string& name, ProcessID p) {
+            char buf[16];
+            snprintf(buf, sizeof(buf), ".%5.5d", p);
+            return name + buf;
+        }
+
+    private:
+        /// Writes the parameters and the nodes of a set of functions
+
+        /// Nodes are given as pointers to containers of (key,node) pairs.
+        /// @return the number of nodes written
+        template <typename T, std::size_t NDIM, typename containerT>
+        static std::size_t write(const std::string& filename, int nproc,
+                const Snapshot<T,NDIM>& snapshot, const std::vector<const containerT*>& nodes) {
+            archive::BinaryFstreamOutputArchive ar(filename.c_str());
+            ar & long(magic) & nproc & long(nodes.size());
+            for (const auto& p : snapshot.parameters) {
+                ar & long(TensorTypeData<T>::id) & long(NDIM) & p;
+            }
+            std::size_t count = 0;
+            for (const containerT* c : nodes) {
+                ar & long(c->size());
+                for (auto it=c->begin(); it!=c->end(); ++it) {
+                    ar & it->first & it->second;
+                }
+                count += c->size();
+            }
+            ar.close();
+            return count;
+        }
+    };
+
+
+    /// Reads a checkpoint written by \c CheckpointWriter; collective
+
+    /// The files are distributed round-robin over the processes, and each
+    /// node is sent to its owner under the current process map.
+    /// @param[in]  world   the world to create the functions in
+    /// @param[in]  name    the base name of the checkpoint files
+    /// @return the functions in the tree state they were saved in
+    template <typename T, std::size_t NDIM>
+    std::vector< Function<T,NDIM> > load_checkpoint(World& world, const std::string& name) {
+        typedef FunctionImpl<T,NDIM> implT;
+
+        long magic = 0, nfunction = 0;
+        int nfile = 0;
+
+        // Every process reads the parameters to create the functions
+        std::vector< Function<T,NDIM> > v;
+        {
+            const std::string filename = CheckpointWriter::local_filename(name, 0);
+            archive::BinaryFstreamInputArchive ar(filename.c_str());
+            ar & magic & nfile & nfunction;
+            MADNESS_CHECK(magic == CheckpointWriter::magic);
+            for (long i=0; i<nfunction; ++i) {
+                long id = 0, ndim = 0;
+                std::vector<unsigned char> parameters;
+                ar & id & ndim & parameters;
+                MADNESS_CHECK(id == TensorTypeData<T>::id);
+                MADNESS_CHECK(ndim == long(NDIM));
+
+                // k is needed to construct the impl and is read again by load_parameters
+                int k = 0;
+                archive::VectorInputArchive(parameters) & k;
+                std::shared_ptr<implT> impl(new implT(FunctionFactory<T,NDIM>(world).k(k).empty()));
+                archive::VectorInputArchive par(parameters);
+                impl->load_parameters(par);
+                v.push_back(Function<T,NDIM>());
+                v.back().set_impl(impl);
+            }
+        }
+
+        for (int p=world.rank(); p<nfile; p+=world.size()) {
+            const std::string filename = CheckpointWriter::local_filename(name, p);
+            archive::BinaryFstreamInputArchive ar(filename.c_str());
+            ar & magic & nfile & nfunction;
+            MADNESS_CHECK(magic == CheckpointWriter::magic);
+            MADNESS_CHECK(nfunction == long(v.size()));
+            for (long i=0; i<nfunction; ++i) {
+                long id = 0, ndim = 0;
+                std::vector<unsigned char> parameters;
+                ar & id & ndim & parameters;
+            }
+            for (auto& f : v) {
+                long count = 0;
+                ar & count;
+                while (count--) {
+                    Key<NDIM> key;
+                    FunctionNode<T,NDIM> node;
+                    ar & key & node;
+                    f.get_impl()->get_coeffs().replace(key,node);
+                }
+            }
+        }
+        world.gop.fence();
+        return v;
+    }
+
+    /// Reads a checkpoint of a single function; collective
+    template <typename T, std::size_t NDIM>
+    void load_checkpoint(World& world, Function<T,NDIM>& f, const std::string& name) {
+        std::vector< Function<T,NDIM> > v = load_checkpoint<T,NDIM>(world, name);
+        MADNESS_CHECK(v.size() == 1);
+        f = v[0];
+    }
+
+}
+
+#endif // MADNESS_MRA_CHECKPOINT_H__INCLUDED
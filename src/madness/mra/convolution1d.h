@@ -41,7 +41,12 @@
 #include <madness/mra/twoscale.h>
 #include <madness/tensor/aligned.h>
 #include <madness/tensor/tensor_lapack.h>
+#include <madness/world/binary_fstream_archive.h>
 #include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unistd.h>
 
 /// \file mra/convolution1d.h
 /// \brief Compuates most matrix elements over 1D operators (including Gaussians)
@@ -223,6 +228,13 @@ namespace madness {
 
 
 
+        /// return the memory held by the operator matrices in bytes
+        std::size_t memory_size() const {
+            typedef typename Tensor<Q>::scalar_type scalar_type;
+            return sizeof(Q)*(R.size()+T.size()+RU.size()+RVT.size()+TU.size()+TVT.size())
+                + sizeof(scalar_type)*(Rs.size()+Ts.size());
+        }
+
         /// approximate the operator matrices using SVD, and abuse Rs to hold the error instead of
         /// the singular values (seriously, who named this??)
         void make_approx(const Tensor<Q>& R,
@@ -274,6 +286,14 @@ namespace madness {
 
         virtual ~Convolution1D() {};
 
+        /// return the memory held by the caches of operator blocks in bytes
+        std::size_t cache_memory_size() const {
+            auto tensor_size = [](const Tensor<Q>& t) {return sizeof(Q)*t.size();};
+            auto data_size = [](const ConvolutionData1D<Q>& d) {return d.memory_size();};
+            return rnlp_cache.memory_size(tensor_size) + rnlij_cache.memory_size(tensor_size)
+                + ns_cache.memory_size(data_size) + mod_ns_cache.memory_size(data_size);
+        }
+
         Convolution1D(int k, int npt, int maxR, double arg = 0.0)
                 : k(k)
                 , npt(npt)
@@ -495,6 +515,33 @@ namespace madness {
         }
 
 
+        /// store the cached rnlp blocks, which are expensive to compute by quadrature
+        template <typename Archive>
+        void store_rnlp_cache(const Archive& ar) const {
+            std::size_t n=rnlp_cache.size();
+            ar & n;
+            typedef typename SimpleCache<Tensor<Q>, 1>::const_iterator iterT;
+            for (iterT it=rnlp_cache.begin(); it!=rnlp_cache.end(); ++it) {
+                Level level=it->first.level();
+                Translation lx=it->first.translation()[0];
+                ar & level & lx & it->second;
+            }
+        }
+
+        /// load rnlp blocks into the cache, keeping those that are already there
+        template <typename Archive>
+        void load_rnlp_cache(const Archive& ar) {
+            std::size_t n=0;
+            ar & n;
+            for (std::size_t i=0; i<n; ++i) {
+                Level level;
+                Translation lx;
+                Tensor<Q> r;
+                ar & level & lx & r;
+                rnlp_cache.set(level, lx, r);
+            }
+        }
+
         const Tensor<Q>& get_rnlp(Level n, Translation lx) const {
             const Tensor<Q>* p=rnlp_cache.getptr(n,lx);
             if (p) return *p;
@@ -845,29 +892,148 @@ namespace madness {
     };
 
 
+    /// Global cache of the 1D Gaussian convolutions, shared by all operators
+
+    /// Operators keep a shared pointer to the 1D convolutions they use, so an
+    /// entry of the cache that is referenced by the cache only belongs to no
+    /// live operator any more. Its operator blocks are stale, e.g. those of
+    /// BSH operators for energies of previous iterations, and they are
+    /// evicted once the memory held by the cache exceeds the memory budget.
+    ///
+    /// The rnlp blocks of the convolutions may also be kept on disk to be
+    /// reused by later runs. Each convolution is stored in its own file, whose
+    /// name is derived from the parameters (k, exponent, derivative order,
+    /// periodicity) and which is read only when the convolution is first
+    /// requested. Files are written to a temporary name and renamed, so
+    /// concurrent readers (e.g. all ranks) never see a partially written file.
     template <typename Q>
     struct GaussianConvolution1DCache {
         static ConcurrentHashMap<hashT, std::shared_ptr< GaussianConvolution1D<Q> > > map;
+        static std::size_t memory_budget;   ///< in bytes; 0 means no limit
+        static std::string directory;       ///< of the persistent cache; empty means none
         typedef typename ConcurrentHashMap<hashT, std::shared_ptr< GaussianConvolution1D<Q> > >::iterator iterator;
         typedef typename ConcurrentHashMap<hashT, std::shared_ptr< GaussianConvolution1D<Q> > >::datumT datumT;
 
-        static std::shared_ptr< GaussianConvolution1D<Q> > get(int k, double expnt, int m, bool periodic) {
+        /// set the memory budget of the cache in bytes; 0 means no limit
+        static void set_memory_budget(std::size_t nbytes) {
+            memory_budget=nbytes;
+        }
+
+        /// return the memory budget of the cache in bytes
+        static std::size_t get_memory_budget() {
+            return memory_budget;
+        }
+
+        /// return the memory held by all cached 1D convolutions in bytes
+        static std::size_t memory_size() {
+            std::size_t total=0;
+            for (iterator it=map.begin(); it!=map.end(); ++it) {
+                total+=it->second->cache_memory_size();
+            }
+            return total;
+        }
+
+        /// remove all entries that are not used by any operator
+
+        /// Not thread safe: the cache must not be accessed concurrently.
+        /// @return the memory released in bytes
+        static std::size_t evict_unused() {
+            std::vector<hashT> unused;
+            std::size_t released=0;
+            for (iterator it=map.begin(); it!=map.end(); ++it) {
+                if (it->second.use_count()==1) {
+                    unused.push_back(it->first);
+                    released+=it->second->cache_memory_size();
+                }
+            }
+            for (const hashT& key : unused) map.erase(key);
+            return released;
+        }
+
+        /// set the directory of the persistent cache; an empty string switches it off
+        static void set_cache_directory(const std::string& dir) {
+            directory=dir;
+        }
+
+        /// return the directory of the persistent cache
+        static const std::string& get_cache_directory() {
+            return directory;
+        }
+
+        /// return the key of the convolution with the given parameters
+        static hashT make_key(int k, double expnt, int m, bool periodic) {
             hashT key = hash_value(expnt);
             hash_combine(key, k);
             hash_combine(key, m);
             hash_combine(key, int(periodic));
+            hash_combine(key, int(sizeof(Q)));
+            return key;
+        }
+
+        /// return the name of the file holding the convolution with the given key
+        static std::string filename(const hashT key) {
+            return directory + "/gconv1d_" + std::to_string(key);
+        }
+
+        /// write the rnlp blocks of all cached convolutions to the cache directory
+
+        /// Should be called by a single process only; existing files are
+        /// replaced, so blocks read from disk and computed since are kept.
+        static void store() {
+            MADNESS_CHECK(not directory.empty());
+            for (iterator it=map.begin(); it!=map.end(); ++it) {
+                const GaussianConvolution1D<Q>& op=*(it->second);
+                const std::string name=filename(it->first);
+                const std::string tmpname=name+".tmp"+std::to_string(getpid());
+                {
+                    archive::BinaryFstreamOutputArchive ar(tmpname.c_str());
+                    int k=op.k, m=op.m, maxR=op.Convolution1D<Q>::maxR;
+                    double expnt=op.expnt;
+                    ar & k & expnt & m & maxR;
+                    op.store_rnlp_cache(ar);
+                }
+                if (std::rename(tmpname.c_str(),name.c_str())!=0) std::remove(tmpname.c_str());
+            }
+        }
+
+        /// read the rnlp blocks of a convolution from the cache directory, if present
+
+        /// The parameters stored with the blocks are compared to those of the
+        /// convolution, so that a hash collision cannot yield wrong blocks.
+        /// @return true if the blocks were read
+        static bool load(const hashT key, GaussianConvolution1D<Q>& op) {
+            if (directory.empty()) return false;
+            const std::string name=filename(key);
+            if (not std::ifstream(name).good()) return false;
+
+            archive::BinaryFstreamInputArchive ar(name.c_str());
+            int k=0, m=0, maxR=0;
+            double expnt=0.0;
+            ar & k & expnt & m & maxR;
+            if ((k!=op.k) or (expnt!=op.expnt) or (m!=op.m)
+                or (maxR!=op.Convolution1D<Q>::maxR)) return false;
+            op.load_rnlp_cache(ar);
+            return true;
+        }
+
+        static std::shared_ptr< GaussianConvolution1D<Q> > get(int k, double expnt, int m, bool periodic) {
+            hashT key = make_key(k, expnt, m, periodic);
 
             MADNESS_PRAGMA_CLANG(diagnostic push)
             MADNESS_PRAGMA_CLANG(diagnostic ignored "-Wundefined-var-template")
 
             iterator it = map.find(key);
             if (it == map.end()) {
-                map.insert(datumT(key, std::make_shared< GaussianConvolution1D<Q> >(k,
-                                                                                    Q(sqrt(expnt/constants::pi)),
-                                                                                    expnt,
-                                                                                    m,
-                                                                                    periodic
-                                                                                    )));
+                if ((memory_budget>0) and (memory_size()>memory_budget)) evict_unused();
+                std::shared_ptr< GaussianConvolution1D<Q> > op=
+                        std::make_shared< GaussianConvolution1D<Q> >(k,
+                                                                    Q(sqrt(expnt/constants::pi)),
+                                                                    expnt,
+                                                                    m,
+                                                                    periodic
+                                                                    );
+                load(key, *op);
+                map.insert(datumT(key, op));
                 it = map.find(key);
                 //printf("conv1d: making  %d %.8e\n",k,expnt);
             }
@@ -252,6 +252,10 @@ namespace madness {
                 return Future<argT>(argT(neigh,coeffT(vk,f->get_tensor_args()))); // Zero bc
             }
             else {
+                keyT found = neigh;
+                if (const auto* replica = f->find_replica(found)) {
+                    return Future<argT>(argT(found, replica->has_coeff() ? replica->coeff() : coeffT()));
+                }
                 Future<argT> result;
 		if (f->get_coeffs().is_local(neigh))
 		  f->send(f->get_coeffs().owner(neigh), &implT::sock_it_to_me, neigh, result.remote_ref(world));
@@ -184,6 +184,7 @@ namespace madness {
         static bool debug;             ///< Controls output of debug info
         static bool truncate_on_project; ///< If true initial projection inserts at n-1 not n
         static bool apply_randomize;   ///< If true use randomization for load balancing in apply integral operator
+        static bool apply_lowrank;     ///< If true apply integral operators in tensor train form where cheaper
         static bool project_randomize; ///< If true use randomization for load balancing in project/refine
         static BoundaryConditions<NDIM> bc; ///< Default boundary conditions
         static Tensor<double> cell ;   ///< cell[NDIM][2] Simulation cell, cell(0,0)=xlo, cell(0,1)=xhi, ...
@@ -349,6 +350,21 @@ namespace madness {
             apply_randomize=value;
         }
 
+        /// Gets the low rank application of integral operators flag
+        static bool get_apply_lowrank() {
+            return apply_lowrank;
+        }
+
+        /// Sets the low rank application of integral operators flag
+
+        /// If true the NS coefficients of each box are decomposed into a
+        /// tensor train, and the operator is applied in that form for all
+        /// displacements where the cost model predicts this to be cheaper
+        /// than the full rank application.
+        static void set_apply_lowrank(bool value) {
+            apply_lowrank=value;
+        }
+
 
         /// Gets the random load balancing for projection flag
         static bool get_project_randomize() {
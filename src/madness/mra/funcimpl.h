@@ -36,11 +36,13 @@
 /// \brief Provides FunctionCommonData, FunctionImpl and FunctionFactory
 
 #include <iostream>
+#include <limits>
 #include <type_traits>
 #include <madness/world/MADworld.h>
 #include <madness/world/print.h>
 #include <madness/misc/misc.h>
 #include <madness/tensor/tensor.h>
+#include <madness/tensor/tensor_expr.h>
 #include <madness/tensor/gentensor.h>
 
 #include <madness/mra/function_common_data.h>
@@ -48,6 +50,7 @@
 #include <madness/mra/key.h>
 #include <madness/mra/funcdefaults.h>
 #include <madness/mra/function_factory.h>
+#include <madness/mra/mirror_symmetry.h>
 
 #include "leafop.h"
 
@@ -780,7 +783,8 @@ namespace madness {
 
     	/// find the coefficients
 
-    	/// this involves communication to a remote node
+    	/// this involves communication to a remote node, unless the node is
+    	/// local or replicated on this process
     	/// @return	a Future<CoeffTracker> with the coefficients that key refers to
     	Future<CoeffTracker> activate() const {
 
@@ -788,6 +792,18 @@ namespace madness {
             if (not impl) return Future<CoeffTracker>(CoeffTracker());
             if (impl->is_on_demand()) return Future<CoeffTracker>(CoeffTracker(impl));
 
+            // local and replicated nodes need no task
+            const typename implT::dcT& coeffs=impl->get_coeffs();
+            const typename implT::nodeT* node=0;
+            if (coeffs.is_local(key_)) {
+                typename implT::dcT::const_iterator it=coeffs.find(key_).get();
+                MADNESS_ASSERT(it!=coeffs.end());
+                node=&(it->second);
+            } else {
+                node=coeffs.find_replica(key_);
+            }
+            if (node) return Future<CoeffTracker>(CoeffTracker(*this,datumT(key_,ShallowNode<T,NDIM>(*node))));
+
             // this will return a <keyT,nodeT> from a remote node
             ProcessID p=impl->get_coeffs().owner(key());
             Future<datumT> datum1=impl->task(p, &implT::find_datum,key_,TaskAttributes::hipri());
@@ -883,6 +899,11 @@ namespace madness {
 
         dcT coeffs; ///< The coefficients
 
+        MirrorSymmetry<NDIM> apply_symmetry; ///< Only irreducible boxes are computed by apply if not empty
+
+        int replica_level; ///< Levels of the tree replicated on all processes, -1 if none
+        mutable std::atomic<std::size_t> replica_nhit; ///< Tree walks answered from the replicas
+
         // Disable the default copy constructor
         FunctionImpl(const FunctionImpl<T,NDIM>& p);
 
@@ -891,6 +912,7 @@ namespace madness {
         Timer timer_lr_result;
         Timer timer_filter;
         Timer timer_compress_svd;
+        Timer timer_reduce_rank;
         Timer timer_target_driven;
         bool do_new;
         AtomicInt small;
@@ -917,6 +939,8 @@ namespace madness {
             , compressed(factory._compressed)
             , redundant(false)
             , coeffs(world,factory._pmap,false)
+            , replica_level(-1)
+            , replica_nhit(0)
             //, bc(factory._bc)
         {
             // PROFILE_MEMBER_FUNC(FunctionImpl); // No need to profile this
@@ -981,6 +1005,8 @@ namespace madness {
                          , compressed(other.compressed)
                          , redundant(other.redundant)
                          , coeffs(world, pmap ? pmap : other.coeffs.get_pmap())
+                         , replica_level(-1)
+                         , replica_nhit(0)
                          //, bc(other.bc)
         {
             if (dozero) {
@@ -1016,6 +1042,7 @@ namespace madness {
         /// @param[in]	g       the other function, reconstructed
         template<typename Q, typename R>
         void gaxpy_inplace_reconstructed(const T& alpha, const FunctionImpl<Q,NDIM>& g, const R& beta, const bool fence) {
+            clear_replicas();
             // merge g's tree into this' tree
             this->merge_trees(beta,g,alpha,true);
 
@@ -1081,6 +1108,7 @@ namespace madness {
         /// @param[in]  beta    prefactor for other
         template <typename Q, typename R>
         void gaxpy_inplace(const T& alpha,const FunctionImpl<Q,NDIM>& other, const R& beta, bool fence) {
+            clear_replicas();
             MADNESS_ASSERT(get_pmap() == other.get_pmap());
             if (alpha != T(1.0)) scale_inplace(alpha,false);
             typedef Range<typename FunctionImpl<Q,NDIM>::dcT::const_iterator> rangeT;
@@ -1090,10 +1118,10 @@ namespace madness {
                 world.gop.fence();
         }
 
-        // loads a function impl from persistence
-        // @param[in] ar   the archive where the function impl is stored
+        // loads the parameters of a function impl, but not its coefficients
+        // @param[in] ar   the archive where the parameters are stored
         template <typename Archive>
-        void load(Archive& ar) {
+        void load_parameters(Archive& ar) {
             // WE RELY ON K BEING STORED FIRST
             int kk = 0;
             ar & kk;
@@ -1103,21 +1131,33 @@ namespace madness {
             // note that functor should not be (re)stored
             ar & thresh & initial_level & max_refine_level & truncate_mode
                 & autorefine & truncate_on_project & nonstandard & compressed ; //& bc;
-
-            ar & coeffs;
-            world.gop.fence();
         }
 
-        // saves a function impl to persistence
-        // @param[in] ar   the archive where the function impl is to be stored
+        // saves the parameters of a function impl, but not its coefficients
+        // @param[in] ar   the archive where the parameters are to be stored
         template <typename Archive>
-        void store(Archive& ar) {
+        void store_parameters(Archive& ar) const {
             // WE RELY ON K BEING STORED FIRST
 
             // note that functor should not be (re)stored
             ar & k & thresh & initial_level & max_refine_level & truncate_mode
                 & autorefine & truncate_on_project & nonstandard & compressed ; //& bc;
+        }
 
+        // loads a function impl from persistence
+        // @param[in] ar   the archive where the function impl is stored
+        template <typename Archive>
+        void load(Archive& ar) {
+            load_parameters(ar);
+            ar & coeffs;
+            world.gop.fence();
+        }
+
+        // saves a function impl to persistence
+        // @param[in] ar   the archive where the function impl is to be stored
+        template <typename Archive>
+        void store(Archive& ar) {
+            store_parameters(ar);
             ar & coeffs;
             world.gop.fence();
         }
@@ -1162,6 +1202,35 @@ namespace madness {
 
         const FunctionCommonData<T,NDIM>& get_cdata() const;
 
+        /// Copies the top \c nlevel levels of the tree onto all processes; collective
+
+        /// Tree walks that pass through these levels are then answered locally
+        /// instead of by the owners of the coarse boxes.  The replicas are
+        /// discarded when the function is compressed, reconstructed,
+        /// truncated, refined or modified in place.
+        void replicate_top(int nlevel, bool fence);
+
+        /// Copies the whole tree onto all processes; collective, optional global fence
+
+        /// Used for the small low-dimensional inputs of 6D constructions, so
+        /// that each 6D box finds them without communication.
+        void replicate_tree(bool fence) {
+            replicate_top(std::numeric_limits<int>::max(), fence);
+        }
+
+        /// Discards the replicas made by replicate_top (no communication)
+        void clear_replicas();
+
+        /// Looks up a box or the leaf above it in the replicas
+
+        /// Returns the node of \c key if it is replicated, or else of the
+        /// replicated leaf that contains it, and then sets \c key to the key of
+        /// that node.  Returns null if the replicas cannot tell.
+        const nodeT* find_replica(keyT& key) const;
+
+        /// Returns the number of remote lookups this process answered from the replicas
+        std::size_t replica_hits() const;
+
         void accumulate_timer(const double time) const; // !!!!!!!!!!!!  REDUNDANT !!!!!!!!!!!!!!!
 
         void print_timer() const;
@@ -1780,8 +1849,9 @@ namespace madness {
 
 
         /// Functor for the mul method
+        /// @return the scaling function coefficients of the product
         template <typename L, typename R>
-        void do_mul(const keyT& key, const Tensor<L>& left, const std::pair< keyT, Tensor<R> >& arg) {
+        tensorT do_mul(const keyT& key, const Tensor<L>& left, const std::pair< keyT, Tensor<R> >& arg) {
             // PROFILE_MEMBER_FUNC(FunctionImpl); // Too fine grain for routine profiling
             const keyT& rkey = arg.first;
             const Tensor<R>& rcoeff = arg.second;
@@ -1795,6 +1865,7 @@ namespace madness {
             double scale = pow(0.5,0.5*NDIM*key.level())*sqrt(FunctionDefaults<NDIM>::get_cell_volume());
             tcube = transform(tcube,cdata.quad_phiw).scale(scale);
             coeffs.replace(key, nodeT(coeffT(tcube,targs),false));
+            return tcube;
         }
 
 
@@ -1885,6 +1956,7 @@ namespace madness {
         /// @param[in] op the unary operator for the coefficients
         template <typename opT>
         void unary_op_coeff_inplace(const opT& op, bool fence) {
+            clear_replicas();
             typename dcT::iterator end = coeffs.end();
             for (typename dcT::iterator it=coeffs.begin(); it!=end; ++it) {
                 const keyT& parent = it->first;
@@ -1906,6 +1978,7 @@ namespace madness {
         /// @param[in] op the unary operator for the coefficients
         template <typename opT>
         void unary_op_node_inplace(const opT& op, bool fence) {
+            clear_replicas();
             typename dcT::iterator end = coeffs.end();
             for (typename dcT::iterator it=coeffs.begin(); it!=end; ++it) {
                 const keyT& parent = it->first;
@@ -2109,6 +2182,23 @@ namespace madness {
             template <typename Archive> void serialize(const Archive& ar) {}
         };
 
+        /// reduce the rank of a batch of nodes, see reduce_rank
+        struct do_reduce_rank_batch {
+            typedef Range<typename std::vector<nodeT*>::iterator> rangeT;
+
+            // threshold for rank reduction / SVD truncation
+            double thresh;
+
+            do_reduce_rank_batch() : thresh(0.0) {}
+            do_reduce_rank_batch(const double& thresh) : thresh(thresh) {}
+
+            bool operator()(typename rangeT::iterator& it) const {
+                (*it)->reduceRank(thresh);
+                return true;
+            }
+            template <typename Archive> void serialize(const Archive& ar) {}
+        };
+
 
 
         /// check symmetry wrt particle exchange
@@ -2153,8 +2243,7 @@ namespace madness {
                     if (have_c1 and have_c2) {
                         tensorT c1=fnode.coeff().full_tensor_copy();
                         tensorT c2=mapnode.coeff().full_tensor_copy();
-                        c2 = copy(c2.mapdim(map));
-                        norm=(c1-c2).normf();
+                        norm=madness::normf(lazy(c1)-c2.mapdim(map));
                     } else if (have_c1) {
                         tensorT c1=fnode.coeff().full_tensor_copy();
                         norm=c1.normf();
@@ -2641,6 +2730,7 @@ namespace madness {
         /// @param[in] op the unary operator for the values
         template <typename opT>
         void unary_op_value_inplace(const opT& op, bool fence) {
+            clear_replicas();
             typedef Range<typename dcT::iterator> rangeT;
             typedef do_unary_op_value_inplace<opT> xopT;
             world.taskq.for_each<rangeT,xopT>(rangeT(coeffs.begin(), coeffs.end()), xopT(this,op));
@@ -2754,6 +2844,157 @@ namespace madness {
             }
         }
 
+        /// Same as mulXXveca() but the products are truncated while they are formed
+
+        /// Once all children of a box are leaves of a product, the box is
+        /// filtered and the children are removed if the difference coefficients
+        /// are negligible, as in truncate_op().  Truncation thus proceeds
+        /// bottom-up as sibling products complete and the untruncated product
+        /// tree is never built.  The products are left reconstructed.
+        /// @return for each product the coefficients of the box if it is a leaf, otherwise empty
+        template <typename L, typename R>
+        Future< std::vector<tensorT> >
+        mulXXveca_truncate(const keyT& key,
+                           const FunctionImpl<L,NDIM>* left, const Tensor<L>& lcin,
+                           const std::vector<const FunctionImpl<R,NDIM>*> vrightin,
+                           const std::vector< Tensor<R> >& vrcin,
+                           const std::vector<FunctionImpl<T,NDIM>*> vresultin,
+                           double tol) {
+            typedef typename FunctionImpl<L,NDIM>::dcT::const_iterator literT;
+            typedef typename FunctionImpl<R,NDIM>::dcT::const_iterator riterT;
+
+            double lnorm = 1e99;
+            Tensor<L> lc = lcin;
+            if (lc.size() == 0) {
+                literT it = left->coeffs.find(key).get();
+                MADNESS_ASSERT(it != left->coeffs.end());
+                lnorm = it->second.get_norm_tree();
+                if (it->second.has_coeff())
+                    lc = it->second.coeff().full_tensor_copy();
+            }
+
+            // Leaves are done here, interior boxes are collected for the recursion
+            std::vector<tensorT> leaves(vrightin.size());
+            std::vector<int> index;
+            std::vector<FunctionImpl<T,NDIM>*> vresult;
+            std::vector<const FunctionImpl<R,NDIM>*> vright;
+            std::vector< Tensor<R> > vrc;
+
+            for (unsigned int i=0; i<vrightin.size(); ++i) {
+                FunctionImpl<T,NDIM>* result = vresultin[i];
+                const FunctionImpl<R,NDIM>* right = vrightin[i];
+                Tensor<R> rc = vrcin[i];
+                double rnorm;
+                if (rc.size() == 0) {
+                    riterT it = right->coeffs.find(key).get();
+                    MADNESS_ASSERT(it != right->coeffs.end());
+                    rnorm = it->second.get_norm_tree();
+                    if (it->second.has_coeff())
+                        rc = it->second.coeff().full_tensor_copy();
+                }
+                else {
+                    rnorm = rc.normf();
+                }
+
+                if (rc.size() && lc.size()) {
+                    leaves[i] = result->do_mul(key, lc, std::make_pair(key,rc));
+                }
+                else if (tol && lnorm*rnorm < truncate_tol(tol, key)) {
+                    leaves[i] = tensorT(cdata.vk);
+                    result->coeffs.replace(key, nodeT(coeffT(leaves[i],targs),false)); // Zero leaf
+                }
+                else {  // Interior node
+                    result->coeffs.replace(key, nodeT(coeffT(),true));
+                    index.push_back(i);
+                    vresult.push_back(result);
+                    vright.push_back(right);
+                    vrc.push_back(rc);
+                }
+            }
+            if (vresult.size() == 0) return Future< std::vector<tensorT> >(leaves);
+
+            Tensor<L> lss;
+            if (lc.size()) {
+                Tensor<L> ld(cdata.v2k);
+                ld(cdata.s0) = lc(___);
+                lss = left->unfilter(ld);
+            }
+
+            std::vector< Tensor<R> > vrss(vresult.size());
+            for (unsigned int i=0; i<vresult.size(); ++i) {
+                if (vrc[i].size()) {
+                    Tensor<R> rd(cdata.v2k);
+                    rd(cdata.s0) = vrc[i](___);
+                    vrss[i] = vright[i]->unfilter(rd);
+                }
+            }
+
+            std::vector< Future< std::vector<tensorT> > > v = future_vector_factory< std::vector<tensorT> >(1<<NDIM);
+            int ichild=0;
+            for (KeyChildIterator<NDIM> kit(key); kit; ++kit, ++ichild) {
+                const keyT& child = kit.key();
+                Tensor<L> ll;
+
+                std::vector<Slice> cp = child_patch(child);
+
+                if (lc.size())
+                    ll = copy(lss(cp));
+
+                std::vector< Tensor<R> > vv(vresult.size());
+                for (unsigned int i=0; i<vresult.size(); ++i) {
+                    if (vrc[i].size())
+                        vv[i] = copy(vrss[i](cp));
+                }
+
+                v[ichild] = woT::task(coeffs.owner(child), &implT:: template mulXXveca_truncate<L,R>,
+                                      child, left, ll, vright, vv, vresult, tol);
+            }
+            return woT::task(world.rank(), &implT::mulXXveca_truncate_op, key, vresult, index, leaves, v);
+        }
+
+        /// Truncates the interior boxes of products once their children are done
+
+        /// @param[in] vresult the products that are interior at \c key
+        /// @param[in] index the position of each of them in \c leaves
+        /// @param[in] leaves the coefficients of the products that are leaves at \c key
+        /// @param[in] v for each child the coefficients of the products in \c vresult that are leaves there
+        /// @return \c leaves with the products added that have become leaves at \c key
+        std::vector<tensorT> mulXXveca_truncate_op(const keyT& key,
+                                                   const std::vector<FunctionImpl<T,NDIM>*>& vresult,
+                                                   const std::vector<int>& index,
+                                                   std::vector<tensorT> leaves,
+                                                   const std::vector< Future< std::vector<tensorT> > >& v) {
+            // >1 rather >0 as in truncate_op()
+            if (key.level() <= 1) return leaves;
+            for (unsigned int i=0; i<vresult.size(); ++i) {
+                tensorT r(cdata.v2k,false);
+                int ichild=0;
+                bool all_leaves=true;
+                for (KeyChildIterator<NDIM> kit(key); kit; ++kit, ++ichild) {
+                    const tensorT& s = v[ichild].get()[i];
+                    if (s.size() == 0) {
+                        all_leaves=false;
+                        break;
+                    }
+                    r(child_patch(kit.key())) = s;
+                }
+                if (not all_leaves) continue;
+
+                FunctionImpl<T,NDIM>* result = vresult[i];
+                tensorT d = filter(r);
+                tensorT s = copy(d(cdata.s0));
+                d(cdata.s0) = T(0);
+                if (d.normf() < result->truncate_tol(result->get_thresh(), key)) {
+                    for (KeyChildIterator<NDIM> kit(key); kit; ++kit) {
+                        result->coeffs.erase(kit.key());
+                    }
+                    result->coeffs.replace(key, nodeT(coeffT(s,result->get_tensor_args()),false));
+                    leaves[index[i]] = s;
+                }
+            }
+            return leaves;
+        }
+
         /// Multiplication using recursive descent and assuming same distribution
         /// Both left and right functions are in the scaling function basis
         /// @param[in] key the key to the current function node (box)
@@ -3023,15 +3264,21 @@ namespace madness {
         /// @param[in] vright vector of pointers to the right function impl's
         /// @param[in] tol numerical tolerance
         /// @param[out] vresult vector of pointers to the resulting function impl's
+        /// @param[in] truncate_on_mul truncate the results while they are formed
         template <typename L, typename R>
         void mulXXvec(const FunctionImpl<L,NDIM>* left,
                       const std::vector<const FunctionImpl<R,NDIM>*>& vright,
                       const std::vector<FunctionImpl<T,NDIM>*>& vresult,
                       double tol,
-                      bool fence) {
+                      bool fence,
+                      bool truncate_on_mul=false) {
             std::vector< Tensor<R> > vr(vright.size());
-            if (world.rank() == coeffs.owner(cdata.key0))
-                mulXXveca(cdata.key0, left, Tensor<L>(), vright, vr, vresult, tol);
+            if (world.rank() == coeffs.owner(cdata.key0)) {
+                if (truncate_on_mul)
+                    mulXXveca_truncate(cdata.key0, left, Tensor<L>(), vright, vr, vresult, tol);
+                else
+                    mulXXveca(cdata.key0, left, Tensor<L>(), vright, vr, vresult, tol);
+            }
             if (fence)
                 world.gop.fence();
         }
@@ -3116,6 +3363,26 @@ namespace madness {
                   const keyT& keyin,
                   const typename Future<T>::remote_refT& ref);
 
+        /// Evaluate the function at a batch of points in \em simulation coordinates
+
+        /// All points must lie inside the box of keyin.  The points are sorted
+        /// into the child boxes on the way down, so that each group travels in
+        /// a single message to the owner of its box, and all points of a leaf
+        /// are evaluated at once.  Only the invoking process will get the
+        /// values, in the order of the input points, via the remote reference.
+        void eval_batch(const std::vector< Vector<double,NDIM> >& xin,
+                        const keyT& keyin,
+                        const typename Future< std::vector<T> >::remote_refT& ref);
+
+        /// Merge the values of the child batches back into the order of the parent batch
+        void eval_batch_gather(const std::vector< std::vector<long> >& index,
+                               const std::vector< Future< std::vector<T> > >& v,
+                               const typename Future< std::vector<T> >::remote_refT& ref) const;
+
+        /// Evaluate the leaf polynomial of box key at many points in simulation coordinates
+        std::vector<T> eval_cube_batch(const keyT& key, const std::vector< Vector<double,NDIM> >& x,
+                                       const tensorT& c) const;
+
         /// Get the depth of the tree at a point in \em simulation coordinates
 
         /// Only the invoking process will get the result via the
@@ -3503,6 +3770,12 @@ namespace madness {
             MADNESS_ASSERT(p1->is_nonstandard());
             MADNESS_ASSERT(p2->is_nonstandard());
 
+            // every 6D box needs the boxes of both particles, so copy the
+            // whole low-dimensional trees to all processes at once
+            const_cast<FunctionImpl<T,LDIM>*>(p1)->replicate_tree(false);
+            if (p2!=p1) const_cast<FunctionImpl<T,LDIM>*>(p2)->replicate_tree(false);
+            world.gop.fence();
+
             const keyT key0=cdata.key0;
 
             if (world.rank() == this->get_coeffs().owner(key0)) {
@@ -3525,7 +3798,11 @@ namespace madness {
             }
 
             this->compressed=false;
-            if (fence) world.gop.fence();
+            if (fence) {
+                world.gop.fence();
+                const_cast<FunctionImpl<T,LDIM>*>(p1)->clear_replicas();
+                const_cast<FunctionImpl<T,LDIM>*>(p2)->clear_replicas();
+            }
         }
 
 
@@ -3985,6 +4262,13 @@ namespace madness {
           if (p1) p1->compress(true,true,false,false);
           if (p2) p2->compress(true,true,false,false);	// fence here
           world.gop.fence();
+
+          // the low-dimensional functions are read by every 6D box
+          if (v1) v1->replicate_tree(false);
+          if (v2 and v2!=v1) v2->replicate_tree(false);
+          if (p1) p1->replicate_tree(false);
+          if (p2 and p2!=p1) p2->replicate_tree(false);
+          world.gop.fence();
           small=0;
           large=0;
 
@@ -4013,6 +4297,10 @@ namespace madness {
           }
 
           world.gop.fence();
+          if (v1) v1->clear_replicas();
+          if (v2) v2->clear_replicas();
+          if (p1) p1->clear_replicas();
+          if (p2) p2->clear_replicas();
 
           // remove internal coefficients
           this->redundant=true;
@@ -4159,6 +4447,7 @@ namespace madness {
         // Refine in real space according to local user-defined criterion
         template <typename opT>
         void refine(const opT& op, bool fence) {
+            clear_replicas();
             if (world.rank() == coeffs.owner(cdata.key0))
                 woT::task(coeffs.owner(cdata.key0), &implT:: template refine_spawn<opT>, op, cdata.key0, TaskAttributes::hipri());
             if (fence)
@@ -4451,6 +4740,20 @@ namespace madness {
 
             const std::vector<opkeyT>& disp = op->get_disp(key.level()); // list of displacements sorted in orer of increasing distance
             const std::vector<bool> is_periodic(NDIM,false); // Periodic sum is already done when making rnlp
+
+            // Loosely converged boxes are often numerically of low rank: decompose
+            // the coefficients into a tensor train once per box, and decide for
+            // each displacement whether applying the operator in that form is
+            // cheaper. The decomposition error is bounded by the largest operator
+            // norm (the one for the zero displacement) so that the error of each
+            // contribution stays below tol/fac.
+            TensorTrain<R> c_tt;
+            const bool try_lowrank=FunctionDefaults<NDIM>::get_apply_lowrank()
+                and (opdim==NDIM) and (not op->modified()) and (c.dim(0)==2*k);
+            if (try_lowrank and (cnorm>0.0)) {
+                const double opnorm0=std::max(1.0,op->norm(key.level(), disp.front(), source));
+                c_tt=TensorTrain<R>(c,0.1*truncate_tol(thresh, key)/fac/opnorm0);
+            }
 	    int ndone=1;	// Counts #done at each distance
 	    uint64_t distsq = 99999999999999; 
             for (typename std::vector<opkeyT>::const_iterator it=disp.begin(); it != disp.end(); ++it) {
@@ -4479,7 +4782,15 @@ namespace madness {
 
                     if (cnorm*opnorm> tol/fac) {
 		        ndone++;
-		        tensorT result = op->apply(source, *it, c, tol/fac/cnorm);
+		        // Images of irreducible boxes are filled in by complete_symmetry()
+		        if (not apply_symmetry.is_irreducible(dest)) continue;
+		        tensorT result;
+		        if ((not c_tt.is_zero_rank())
+		            and (op->estimate_costs_tt(source, *it, c_tt, tol/fac/cnorm)>1.0)) {
+		            result = op->apply_tt(source, *it, c_tt, tol/fac/cnorm);
+		        } else {
+		            result = op->apply(source, *it, c, tol/fac/cnorm);
+		        }
 			if (result.normf() > 0.3*tol/fac) {
 			  if (coeffs.is_local(dest))
 			      coeffs.send(dest, &nodeT::accumulate2, result, coeffs, dest);
@@ -4506,7 +4817,8 @@ namespace madness {
                     if (node.coeff().dim(0) != k || op.doleaves) {
                         ProcessID p = FunctionDefaults<NDIM>::get_apply_randomize() ? world.random_proc() : coeffs.owner(key);
 //                        woT::task(p, &implT:: template do_apply<opT,R>, &op, key, node.coeff()); //.full_tensor_copy() ????? why copy ????
-                        woT::task(p, &implT:: template do_apply<opT,R>, &op, key, node.coeff().reconstruct_tensor());
+                        woT::task(p, &implT:: template do_apply<opT,R>, &op, key, node.coeff().reconstruct_tensor(),
+                                  TaskAttributes::affinity(key.hash()));
                     }
                 }
             }
@@ -4519,6 +4831,52 @@ namespace madness {
 
         }
 
+        /// Apply an operator to a function of definite mirror symmetry
+
+        /// Only the irreducible boxes of the result are computed, the others
+        /// are their images.  The operator must be invariant under the
+        /// reflections, as are all isotropic convolutions.  Always fences.
+        template <typename opT, typename R>
+        void apply(opT& op, const FunctionImpl<R,NDIM>& f, const MirrorSymmetry<NDIM>& symmetry) {
+            symmetry.check_cell();
+            apply_symmetry = symmetry;
+            world.gop.fence();  // all processes must screen before any task arrives
+            apply(op, f, true);
+            apply_symmetry = MirrorSymmetry<NDIM>();
+            complete_symmetry(symmetry, true);
+        }
+
+        /// Adds the images of the coefficients of all irreducible boxes
+
+        /// Works in either basis and in nonstandard form.  Only irreducible
+        /// boxes may hold coefficients, as after a symmetry-adapted apply.
+        /// Boxes with children are mirrored as well, and all new boxes are
+        /// connected to their parents.
+        void complete_symmetry(const MirrorSymmetry<NDIM>& symmetry, bool fence) {
+            std::vector< std::pair<keyT,tensorT> > images;
+            std::vector<keyT> parents;
+            typename dcT::const_iterator end = coeffs.end();
+            for (typename dcT::const_iterator it=coeffs.begin(); it!=end; ++it) {
+                const keyT& key = it->first;
+                const nodeT& node = it->second;
+                if (key.level() == 0) continue;
+                for (std::size_t i=0; i<symmetry.size(); ++i) {
+                    if (node.has_children()) parents.push_back(symmetry.image(key,i));
+                }
+                if (not (node.has_coeff() and symmetry.is_irreducible(key))) continue;
+                const tensorT c = node.coeff().full_tensor_copy();
+                for (std::size_t i=0; i<symmetry.size(); ++i) {
+                    images.push_back(std::make_pair(symmetry.image(key,i), symmetry.image(c,i)));
+                }
+            }
+            for (const keyT& key : parents) {
+                coeffs.task(key, &nodeT::set_has_children_recursive, coeffs, key);
+            }
+            for (const auto& image : images) {
+                coeffs.task(image.first, &nodeT::accumulate2, image.second, coeffs, image.first);
+            }
+            if (fence) world.gop.fence();
+        }
 
 
         /// apply an operator on the coeffs c (at node key)
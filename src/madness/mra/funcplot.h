@@ -33,6 +33,10 @@
 #define MADNESS_MRA_FUNCPLOT_H__INCLUDED
 
 #include <madness/constants.h>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
 
 /*!
 
@@ -321,6 +325,319 @@ namespace madness {
         inline unsigned short htons_x(unsigned short a) {
             return (a>>8) | (a<<8);
         }
+
+        /// Collects the arrays of a VTK XML file for raw binary appended output
+        class VTKAppendedData {
+            std::vector< std::vector<char> > blocks;
+            uint64_t offset;
+
+        public:
+            VTKAppendedData() : offset(0) {}
+
+            /// Adds an array and returns the DataArray tag that refers to it
+            template <typename Q>
+            std::string add(const std::vector<Q>& data, const char* type,
+                            const std::string& name, int ncomponent) {
+                const uint64_t nbytes = data.size()*sizeof(Q);
+                std::vector<char> block(sizeof(nbytes) + nbytes);
+                std::memcpy(&block[0], &nbytes, sizeof(nbytes));
+                if (nbytes) std::memcpy(&block[sizeof(nbytes)], &data[0], nbytes);
+
+                std::ostringstream tag;
+                tag << "<DataArray type=\"" << type << "\"";
+                if (name.size()) tag << " Name=\"" << name << "\"";
+                tag << " NumberOfComponents=\"" << ncomponent << "\""
+                    << " format=\"appended\" offset=\"" << offset << "\"/>\n";
+                offset += block.size();
+                blocks.push_back(block);
+                return tag.str();
+            }
+
+            /// Writes the AppendedData section
+            void write(std::ostream& os) const {
+                os << "  <AppendedData encoding=\"raw\">\n_";
+                for (std::size_t i=0; i<blocks.size(); ++i) os.write(&blocks[i][0], blocks[i].size());
+                os << "\n  </AppendedData>\n";
+            }
+        };
+
+        /// Function values as VTK components: one for real, two for complex
+        inline void vtk_push_value(std::vector<double>& v, double value) {
+            v.push_back(value);
+        }
+
+        inline void vtk_push_value(std::vector<double>& v, const double_complex& value) {
+            v.push_back(real(value));
+            v.push_back(imag(value));
+        }
+
+        template <typename T>
+        int vtk_ncomponent() {
+            return TensorTypeData<T>::iscomplex ? 2 : 1;
+        }
+
+        /// VTK file name of the piece of a process, without directory
+        inline std::string vtk_piece_name(const char* basename, ProcessID p, const char* ext) {
+            std::ostringstream s;
+            s << basename << "_" << p << "." << ext;
+            return s.str();
+        }
+
+        inline std::string vtk_strip_directory(const std::string& filename) {
+            const std::size_t pos = filename.find_last_of('/');
+            return (pos == std::string::npos) ? filename : filename.substr(pos+1);
+        }
+    }
+
+    /// Writes functions on a uniform grid as binary VTK ImageData, one piece per process
+
+    /// Collective operation.  Every process evaluates and writes the points of
+    /// its own slab of the grid (split along the last dimension) to
+    /// \c basename_<rank>.vti, without gathering the data onto process 0.
+    /// Process 0 writes the index \c basename.pvti, which is the file to open
+    /// in Paraview/VisIt.  Values are stored as raw little-endian Float64;
+    /// complex functions have two components (real, imaginary).
+    /// @param[in] vf       the functions to plot
+    /// @param[in] names    the names of the fields
+    /// @param[in] basename file name without extension
+    /// @param[in] plotlo   lower corner of the plot box in user coordinates
+    /// @param[in] plothi   upper corner of the plot box in user coordinates
+    /// @param[in] npt      number of points in each dimension
+    template<typename T, std::size_t NDIM>
+    void plotvti(const std::vector< Function<T,NDIM> >& vf, const std::vector<std::string>& names,
+                 const char* basename, const Vector<double,NDIM>& plotlo,
+                 const Vector<double,NDIM>& plothi, const Vector<long,NDIM>& npt) {
+        PROFILE_FUNC;
+        MADNESS_ASSERT(NDIM>=1 && NDIM<=3);
+        MADNESS_ASSERT(vf.size()>0 && vf.size()==names.size());
+        World& world = vf[0].world();
+        for (std::size_t i=0; i<vf.size(); ++i) vf[i].reconstruct(false);
+        world.gop.fence();
+
+        Vector<double,NDIM> space;
+        for (std::size_t d=0; d<NDIM; ++d) {
+            space[d] = (npt[d] == 1) ? 0.0 : (plothi[d] - plotlo[d])/(npt[d] - 1);
+        }
+
+        // slab of the last dimension for process p; neighboring pieces share a plane
+        const long nlast = npt[NDIM-1];
+        const long ncell = std::max(nlast-1, 1l);
+        auto slab = [&](ProcessID p) {
+            if (nlast == 1) return std::make_pair(long(p), 0l);    // empty for p>0
+            long lo = (ncell*p)/world.size();
+            long hi = (ncell*(p+1))/world.size();
+            if (lo == hi) return std::make_pair(1l, 0l);           // more processes than cells
+            return std::make_pair(lo, hi);
+        };
+        auto extent = [&](long lo, long hi) {
+            std::ostringstream s;
+            for (std::size_t d=0; d<3; ++d) {
+                if (d == NDIM-1) s << lo << " " << hi << " ";
+                else if (d < NDIM) s << 0 << " " << npt[d]-1 << " ";
+                else s << "0 0 ";
+            }
+            return s.str();
+        };
+        std::ostringstream origin, spacing;
+        for (std::size_t d=0; d<3; ++d) {
+            origin << ((d < NDIM) ? plotlo[d] : 0.0) << " ";
+            spacing << ((d < NDIM) ? space[d] : 1.0) << " ";
+        }
+
+        // the points of this process, x fastest as VTK expects
+        const std::pair<long,long> myslab = slab(world.rank());
+        std::vector< Vector<double,NDIM> > points;
+        if (myslab.first <= myslab.second) {
+            std::vector<long> n(NDIM);
+            for (std::size_t d=0; d<NDIM; ++d) n[d] = npt[NDIM-1-d];
+            n[0] = myslab.second - myslab.first + 1;
+            for (LowDimIndexIterator it(n); it; ++it) {
+                Vector<double,NDIM> r;
+                for (std::size_t d=0; d<NDIM; ++d) r[d] = plotlo[d] + it[NDIM-1-d]*space[d];
+                r[NDIM-1] = plotlo[NDIM-1] + (it[0] + myslab.first)*space[NDIM-1];
+                points.push_back(r);
+            }
+        }
+
+        // all functions are evaluated concurrently
+        std::vector< Future< std::vector<T> > > values;
+        for (std::size_t i=0; i<vf.size(); ++i) values.push_back(vf[i].eval(points));
+
+        if (points.size()) {
+            detail::VTKAppendedData data;
+            std::ostringstream pointdata;
+            for (std::size_t i=0; i<vf.size(); ++i) {
+                const std::vector<T>& v = values[i].get();
+                std::vector<double> buf;
+                buf.reserve(v.size()*detail::vtk_ncomponent<T>());
+                for (std::size_t j=0; j<v.size(); ++j) detail::vtk_push_value(buf, v[j]);
+                pointdata << "        " << data.add(buf, "Float64", names[i], detail::vtk_ncomponent<T>());
+            }
+
+            std::string filename = detail::vtk_piece_name(basename, world.rank(), "vti");
+            std::ofstream f(filename.c_str(), std::ios::binary);
+            if (!f) MADNESS_EXCEPTION("plotvti: failed to open the plot file", 0);
+            f << "<?xml version=\"1.0\"?>\n"
+              << "<VTKFile type=\"ImageData\" version=\"1.0\" byte_order=\"LittleEndian\" header_type=\"UInt64\">\n"
+              << "  <ImageData WholeExtent=\"" << extent(0, nlast-1) << "\" Origin=\"" << origin.str()
+              << "\" Spacing=\"" << spacing.str() << "\">\n"
+              << "    <Piece Extent=\"" << extent(myslab.first, myslab.second) << "\">\n"
+              << "      <PointData Scalars=\"" << names[0] << "\">\n" << pointdata.str()
+              << "      </PointData>\n"
+              << "    </Piece>\n"
+              << "  </ImageData>\n";
+            data.write(f);
+            f << "</VTKFile>\n";
+        }
+
+        if (world.rank() == 0) {
+            std::string filename = std::string(basename) + ".pvti";
+            std::ofstream f(filename.c_str());
+            if (!f) MADNESS_EXCEPTION("plotvti: failed to open the plot file", 0);
+            f << "<?xml version=\"1.0\"?>\n"
+              << "<VTKFile type=\"PImageData\" version=\"1.0\" byte_order=\"LittleEndian\" header_type=\"UInt64\">\n"
+              << "  <PImageData WholeExtent=\"" << extent(0, nlast-1) << "\" GhostLevel=\"0\" Origin=\""
+              << origin.str() << "\" Spacing=\"" << spacing.str() << "\">\n"
+              << "    <PPointData Scalars=\"" << names[0] << "\">\n";
+            for (std::size_t i=0; i<names.size(); ++i) {
+                f << "      <PDataArray type=\"Float64\" Name=\"" << names[i]
+                  << "\" NumberOfComponents=\"" << detail::vtk_ncomponent<T>() << "\"/>\n";
+            }
+            f << "    </PPointData>\n";
+            for (ProcessID p=0; p<world.size(); ++p) {
+                const std::pair<long,long> s = slab(p);
+                if (s.first > s.second) continue;
+                f << "    <Piece Extent=\"" << extent(s.first, s.second) << "\" Source=\""
+                  << detail::vtk_strip_directory(detail::vtk_piece_name(basename, p, "vti")) << "\"/>\n";
+            }
+            f << "  </PImageData>\n"
+              << "</VTKFile>\n";
+        }
+        world.gop.fence();
+    }
+
+    /// Writes a function on a uniform grid as binary VTK ImageData, one piece per process
+
+    /// See plotvti() for several functions.
+    template<typename T, std::size_t NDIM>
+    void plotvti(const Function<T,NDIM>& f, const char* fieldname, const char* basename,
+                 const Vector<double,NDIM>& plotlo, const Vector<double,NDIM>& plothi,
+                 const Vector<long,NDIM>& npt) {
+        plotvti(std::vector< Function<T,NDIM> >(1,f), std::vector<std::string>(1,fieldname),
+                basename, plotlo, plothi, npt);
+    }
+
+    /// Writes the adaptive tree of a function as binary VTK UnstructuredGrid, one piece per process
+
+    /// Collective operation without resampling and without communication: every
+    /// process writes its local leaf boxes as VTK cells (line/pixel/voxel) to
+    /// \c basename_<rank>.vtu, with the function values of the leaf polynomial
+    /// at the box corners as point data and the refinement level as cell data.
+    /// Process 0 writes the index \c basename.pvtu.
+    /// @param[in] function the function to plot
+    /// @param[in] fieldname name of the field
+    /// @param[in] basename file name without extension
+    template<typename T, std::size_t NDIM>
+    void plotvtu_tree(const Function<T,NDIM>& function, const char* fieldname, const char* basename) {
+        PROFILE_FUNC;
+        MADNESS_ASSERT(NDIM>=1 && NDIM<=3);
+        typedef FunctionImpl<T,NDIM> implT;
+        typedef typename implT::dcT dcT;
+        World& world = function.world();
+        function.reconstruct();
+
+        const Tensor<double>& cell = FunctionDefaults<NDIM>::get_cell();
+        const Tensor<double>& width = FunctionDefaults<NDIM>::get_cell_width();
+        const std::shared_ptr<implT>& impl = function.get_impl();
+        const dcT& coeffs = impl->get_coeffs();
+        const int ncorner = 1<<NDIM;
+        const unsigned char celltype = (NDIM==1) ? 3 : ((NDIM==2) ? 8 : 11);   // VTK_LINE, VTK_PIXEL, VTK_VOXEL
+
+        std::vector<double> points, values;
+        std::vector<int64_t> connectivity, offsets;
+        std::vector<unsigned char> types;
+        std::vector<int32_t> levels;
+        for (typename dcT::const_iterator it=coeffs.begin(); it!=coeffs.end(); ++it) {
+            const Key<NDIM>& key = it->first;
+            const FunctionNode<T,NDIM>& node = it->second;
+            if (not node.has_coeff()) continue;
+            const Level n = key.level();
+            const double h = std::ldexp(1.0, -n);
+            const Tensor<T> c = node.coeff().full_tensor_copy();
+
+            // corners with dimension 0 varying fastest, as VTK voxels expect
+            for (int corner=0; corner<ncorner; ++corner) {
+                Vector<double,NDIM> x;
+                for (std::size_t d=0; d<NDIM; ++d) {
+                    x[d] = (corner>>d) & 1;
+                    points.push_back(cell(d,0) + width(d)*h*(key.translation()[d] + x[d]));
+                }
+                for (std::size_t d=NDIM; d<3; ++d) points.push_back(0.0);
+                detail::vtk_push_value(values, impl->eval_cube(n, x, c));
+                connectivity.push_back(connectivity.size());
+            }
+            offsets.push_back(connectivity.size());
+            types.push_back(celltype);
+            levels.push_back(n);
+        }
+
+        const std::string name = fieldname;
+        std::ostringstream head;
+        detail::VTKAppendedData data;
+        head << "      <PointData Scalars=\"" << name << "\">\n"
+             << "        " << data.add(values, "Float64", name, detail::vtk_ncomponent<T>())
+             << "      </PointData>\n"
+             << "      <CellData Scalars=\"level\">\n"
+             << "        " << data.add(levels, "Int32", "level", 1)
+             << "      </CellData>\n"
+             << "      <Points>\n"
+             << "        " << data.add(points, "Float64", "", 3)
+             << "      </Points>\n"
+             << "      <Cells>\n"
+             << "        " << data.add(connectivity, "Int64", "connectivity", 1)
+             << "        " << data.add(offsets, "Int64", "offsets", 1)
+             << "        " << data.add(types, "UInt8", "types", 1)
+             << "      </Cells>\n";
+
+        std::string filename = detail::vtk_piece_name(basename, world.rank(), "vtu");
+        std::ofstream f(filename.c_str(), std::ios::binary);
+        if (!f) MADNESS_EXCEPTION("plotvtu_tree: failed to open the plot file", 0);
+        f << "<?xml version=\"1.0\"?>\n"
+          << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\"LittleEndian\" header_type=\"UInt64\">\n"
+          << "  <UnstructuredGrid>\n"
+          << "    <Piece NumberOfPoints=\"" << connectivity.size() << "\" NumberOfCells=\"" << types.size() << "\">\n"
+          << head.str()
+          << "    </Piece>\n"
+          << "  </UnstructuredGrid>\n";
+        data.write(f);
+        f << "</VTKFile>\n";
+        f.close();
+
+        if (world.rank() == 0) {
+            std::string filename = std::string(basename) + ".pvtu";
+            std::ofstream f(filename.c_str());
+            if (!f) MADNESS_EXCEPTION("plotvtu_tree: failed to open the plot file", 0);
+            f << "<?xml version=\"1.0\"?>\n"
+              << "<VTKFile type=\"PUnstructuredGrid\" version=\"1.0\" byte_order=\"LittleEndian\" header_type=\"UInt64\">\n"
+              << "  <PUnstructuredGrid GhostLevel=\"0\">\n"
+              << "    <PPointData Scalars=\"" << name << "\">\n"
+              << "      <PDataArray type=\"Float64\" Name=\"" << name
+              << "\" NumberOfComponents=\"" << detail::vtk_ncomponent<T>() << "\"/>\n"
+              << "    </PPointData>\n"
+              << "    <PCellData Scalars=\"level\">\n"
+              << "      <PDataArray type=\"Int32\" Name=\"level\" NumberOfComponents=\"1\"/>\n"
+              << "    </PCellData>\n"
+              << "    <PPoints>\n"
+              << "      <PDataArray type=\"Float64\" NumberOfComponents=\"3\"/>\n"
+              << "    </PPoints>\n";
+            for (ProcessID p=0; p<world.size(); ++p) {
+                f << "    <Piece Source=\""
+                  << detail::vtk_strip_directory(detail::vtk_piece_name(basename, p, "vtu")) << "\"/>\n";
+            }
+            f << "  </PUnstructuredGrid>\n"
+              << "</VTKFile>\n";
+        }
+        world.gop.fence();
     }
 
     /// Writes a Povray DF3 format file with a cube of points on a uniform grid
@@ -429,10 +746,12 @@ namespace madness {
             FILE* file = fopen(filename,"w");
 	    if(!file)
 	      MADNESS_EXCEPTION("plot_line: failed to open the plot file", 0);
+            std::vector<coordT> r(npt);
+            for (int i=0; i<npt; ++i) r[i] = lo + h*double(i);
+            Future< std::vector<T> > fr = f.eval(r);
             for (int i=0; i<npt; ++i) {
-                coordT r = lo + h*double(i);
                 fprintf(file, "%.14e ", i*sum);
-                plot_line_print_value(file, f.eval(r));
+                plot_line_print_value(file, fr.get()[i]);
                 fprintf(file,"\n");
             }
             fclose(file);
@@ -460,11 +779,14 @@ namespace madness {
             FILE* file = fopen(filename,"w");
 	    if(!file)
 	      MADNESS_EXCEPTION("plot_line: failed to open the plot file", 0);
+            std::vector<coordT> r(npt);
+            for (int i=0; i<npt; ++i) r[i] = lo + h*double(i);
+            Future< std::vector<T> > fr = f.eval(r);
+            Future< std::vector<U> > gr = g.eval(r);
             for (int i=0; i<npt; ++i) {
-                coordT r = lo + h*double(i);
                 fprintf(file, "%.14e ", i*sum);
-                plot_line_print_value(file, f.eval(r));
-                plot_line_print_value(file, g.eval(r));
+                plot_line_print_value(file, fr.get()[i]);
+                plot_line_print_value(file, gr.get()[i]);
                 fprintf(file,"\n");
             }
             fclose(file);
@@ -494,12 +816,16 @@ namespace madness {
             FILE* file = fopen(filename,"w");
 	    if(!file)
 	      MADNESS_EXCEPTION("plot_line: failed to open the plot file", 0);
+            std::vector<coordT> r(npt);
+            for (int i=0; i<npt; ++i) r[i] = lo + h*double(i);
+            Future< std::vector<T> > fr = f.eval(r);
+            Future< std::vector<U> > gr = g.eval(r);
+            Future< std::vector<V> > ar = a.eval(r);
             for (int i=0; i<npt; ++i) {
-                coordT r = lo + h*double(i);
                 fprintf(file, "%.14e ", i*sum);
-                plot_line_print_value(file, f.eval(r));
-                plot_line_print_value(file, g.eval(r));
-                plot_line_print_value(file, a.eval(r));
+                plot_line_print_value(file, fr.get()[i]);
+                plot_line_print_value(file, gr.get()[i]);
+                plot_line_print_value(file, ar.get()[i]);
                 fprintf(file,"\n");
             }
             fclose(file);
@@ -527,13 +853,18 @@ namespace madness {
         b.reconstruct();
         if (world.rank() == 0) {
             FILE* file = fopen(filename,"w");
+            std::vector<coordT> r(npt);
+            for (int i=0; i<npt; ++i) r[i] = lo + h*double(i);
+            Future< std::vector<T> > fr = f.eval(r);
+            Future< std::vector<U> > gr = g.eval(r);
+            Future< std::vector<V> > ar = a.eval(r);
+            Future< std::vector<W> > br = b.eval(r);
             for (int i=0; i<npt; ++i) {
-                coordT r = lo + h*double(i);
                 fprintf(file, "%.14e ", i*sum);
-                plot_line_print_value(file, f.eval(r));
-                plot_line_print_value(file, g.eval(r));
-                plot_line_print_value(file, a.eval(r));
-                plot_line_print_value(file, b.eval(r));
+                plot_line_print_value(file, fr.get()[i]);
+                plot_line_print_value(file, gr.get()[i]);
+                plot_line_print_value(file, ar.get()[i]);
+                plot_line_print_value(file, br.get()[i]);
                 fprintf(file,"\n");
             }
             fclose(file);
@@ -0,0 +1,153 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_MRA_MIRROR_SYMMETRY_H__INCLUDED
+#define MADNESS_MRA_MIRROR_SYMMETRY_H__INCLUDED
+
+/// \file mirror_symmetry.h
+/// \brief Reflection symmetry of functions through the coordinate planes
+
+#include <vector>
+#include <madness/tensor/tensor.h>
+#include <madness/mra/key.h>
+#include <madness/mra/funcdefaults.h>
+
+namespace madness {
+
+    /// A group of reflections through the coordinate planes and the characters of a function
+
+    /// Describes functions with \c f(g*r)=chi(g)*f(r) for all elements \c g
+    /// of the group, where each \c g flips the sign of some coordinates (the
+    /// point group D2h and its subgroups).  Below the root every box is
+    /// either irreducible or the image of exactly one irreducible box under
+    /// each group element, so the coefficients of all boxes follow from
+    /// those of the irreducible ones.  The irreducible box of each orbit is
+    /// the one with the largest translation in lexicographic order.
+    ///
+    /// The cell must be symmetric about the origin in all reflected dimensions.
+    /// \code
+    /// MirrorSymmetry<3> b1u;                      // D2h, irrep B1u (z-like)
+    /// b1u.add({ 1, 1,-1},-1).add({ 1,-1, 1}, 1).add({-1, 1, 1}, 1)
+    ///    .add({-1,-1, 1}, 1).add({-1, 1,-1},-1).add({ 1,-1,-1},-1).add({-1,-1,-1},-1);
+    /// \endcode
+    template <std::size_t NDIM>
+    class MirrorSymmetry {
+        std::vector< std::vector<long> > mirrors;  ///< Mirror maps of the group elements except the identity
+        std::vector<double> characters;           ///< Characters of the group elements except the identity
+
+    public:
+        /// Makes the trivial group
+        MirrorSymmetry() {}
+
+        /// Adds a group element; all elements except the identity must be added
+
+        /// @param[in] mirror   -1 for reflected dimensions and 1 otherwise, as for \c mirror()
+        /// @param[in] character the character of the element, +1 or -1
+        MirrorSymmetry& add(const std::vector<long>& mirror, double character) {
+            MADNESS_CHECK(mirror.size() == NDIM);
+            MADNESS_CHECK(character == 1.0 || character == -1.0);
+            for (long m : mirror) MADNESS_CHECK(m == 1 || m == -1);
+            mirrors.push_back(mirror);
+            characters.push_back(character);
+            return *this;
+        }
+
+        /// Returns the no. of group elements except the identity
+        std::size_t size() const {return mirrors.size();}
+
+        /// Returns true for the trivial group
+        bool empty() const {return mirrors.empty();}
+
+        /// Returns the character of element \c i
+        double character(std::size_t i) const {return characters[i];}
+
+        /// Returns the mirror map of element \c i
+        const std::vector<long>& mirror(std::size_t i) const {return mirrors[i];}
+
+        /// Throws unless the cell is symmetric about the origin in the reflected dimensions
+        void check_cell() const {
+            const Tensor<double>& cell = FunctionDefaults<NDIM>::get_cell();
+            for (const auto& m : mirrors) {
+                for (std::size_t d=0; d<NDIM; ++d) {
+                    if (m[d] == -1 && cell(d,0) != -cell(d,1)) {
+                        MADNESS_EXCEPTION("MirrorSymmetry: cell is not symmetric about the origin", d);
+                    }
+                }
+            }
+        }
+
+        /// Returns the image of a box under element \c i
+        Key<NDIM> image(const Key<NDIM>& key, std::size_t i) const {
+            const Translation lmax = (Translation(1)<<key.level()) - 1;
+            Vector<Translation,NDIM> l = key.translation();
+            for (std::size_t d=0; d<NDIM; ++d) {
+                if (mirrors[i][d] == -1) l[d] = lmax - l[d];
+            }
+            return Key<NDIM>(key.level(), l);
+        }
+
+        /// Returns the coefficients of the image of a box under element \c i
+
+        /// Scaling functions and multiwavelets of index \c j both have the
+        /// parity \c (-1)^j about the center of the box, so this works for
+        /// both the \c (k,...) and the \c (2k,...) nonstandard coefficients.
+        template <typename T>
+        Tensor<T> image(const Tensor<T>& c, std::size_t i) const {
+            Tensor<T> r = copy(c);
+            if (r.size() == 0) return r;
+            std::vector<Slice> s(NDIM, _);
+            for (std::size_t d=0; d<NDIM; ++d) {
+                if (mirrors[i][d] == -1) {
+                    for (long j=1; j<r.dim(d); j+=2) {
+                        s[d] = Slice(j,j,1);
+                        r(s).scale(T(-1));
+                    }
+                    s[d] = _;
+                }
+            }
+            if (characters[i] != 1.0) r.scale(T(characters[i]));
+            return r;
+        }
+
+        /// Returns true if the box is the irreducible one of its orbit (always true at level 0)
+        bool is_irreducible(const Key<NDIM>& key) const {
+            if (key.level() == 0) return true;
+            const Vector<Translation,NDIM>& l = key.translation();
+            for (std::size_t i=0; i<mirrors.size(); ++i) {
+                if (l < image(key,i).translation()) return false;
+            }
+            return true;
+        }
+    };
+
+}
+
+#endif // MADNESS_MRA_MIRROR_SYMMETRY_H__INCLUDED
@@ -211,6 +211,48 @@ namespace madness {
             return result;
         }
 
+        /// Evaluates the function at many points in user coordinates.  Possible non-blocking comm.
+
+        /// Much faster than calling eval() point by point: the points are
+        /// sorted into the leaf boxes in a single tree walk, each group of
+        /// points is sent in a single message to the owner of its box, and
+        /// all points of a leaf are evaluated at once.  Only the invoking
+        /// process will receive the values, in the order of the points.
+        ///
+        /// Throws if function is not initialized.
+        Future< std::vector<T> > eval(const std::vector<coordT>& xuser) const {
+            PROFILE_MEMBER_FUNC(Function);
+            const double eps=1e-15;
+            verify();
+            MADNESS_ASSERT(!is_compressed());
+            std::vector<coordT> xsim(xuser.size());
+            for (std::size_t i=0; i<xuser.size(); ++i) {
+                user_to_sim(xuser[i],xsim[i]);
+                // If on the boundary, move the point just inside the
+                // volume so that the evaluation logic does not fail
+                for (std::size_t d=0; d<NDIM; ++d) {
+                    if (xsim[i][d] < -eps) {
+                        MADNESS_EXCEPTION("eval: coordinate lower-bound error in dimension", d);
+                    }
+                    else if (xsim[i][d] < eps) {
+                        xsim[i][d] = eps;
+                    }
+
+                    if (xsim[i][d] > 1.0+eps) {
+                        MADNESS_EXCEPTION("eval: coordinate upper-bound error in dimension", d);
+                    }
+                    else if (xsim[i][d] > 1.0-eps) {
+                        xsim[i][d] = 1.0-eps;
+                    }
+                }
+            }
+
+            Future< std::vector<T> > result;
+            if (xsim.empty()) result.set(std::vector<T>());
+            else impl->eval_batch(xsim, impl->key0(), result.remote_ref(impl->world));
+            return result;
+        }
+
         /// Evaluate function only if point is local returning (true,value); otherwise return (false,0.0)
 
         /// maxlevel is the maximum depth to search down to --- the max local depth can be
@@ -566,6 +608,37 @@ namespace madness {
         }
 
 
+        /// Copies the top levels of the tree onto all processes.  Collective, optional global fence.
+
+        /// Evaluation, derivatives and other tree walks that pass through
+        /// the coarse boxes then find them locally instead of messaging
+        /// their few owners.  The copies are read-only and are discarded
+        /// when the function is compressed, reconstructed, truncated,
+        /// refined or modified in place; call again to refresh them.
+        /// @param[in] nlevel replicate the boxes of levels 0 to \c nlevel
+        void replicate_top(int nlevel, bool fence = true) {
+            PROFILE_MEMBER_FUNC(Function);
+            verify();
+            impl->replicate_top(nlevel, fence);
+        }
+
+
+        /// Discards the copies made by replicate_top.  No communication.
+        void clear_replicas() {
+            PROFILE_MEMBER_FUNC(Function);
+            verify();
+            impl->clear_replicas();
+        }
+
+
+        /// Returns the number of remote lookups this process answered from the replicas.  No communication.
+        std::size_t replica_hits() const {
+            PROFILE_MEMBER_FUNC(Function);
+            verify();
+            return impl->replica_hits();
+        }
+
+
         /// Truncate the function with optional fence.  Compresses with fence if not compressed.
 
         /// If the truncation threshold is less than or equal to zero the default value
@@ -1474,12 +1547,16 @@ namespace madness {
 
 
         /// Multiplication of function * vector of functions using recursive algorithm of mulxx
+
+        /// With \c truncate_on_mul the results are truncated while they are
+        /// formed and are left reconstructed
         template <typename L, typename R>
         void vmulXX(const Function<L,NDIM>& left,
                     const std::vector< Function<R,NDIM> >& right,
                     std::vector< Function<T,NDIM> >& result,
                     double tol,
-                    bool fence) {
+                    bool fence,
+                    bool truncate_on_mul=false) {
             PROFILE_MEMBER_FUNC(Function);
 
             std::vector<FunctionImpl<T,NDIM>*> vresult(right.size());
@@ -1491,7 +1568,7 @@ namespace madness {
             }
 
             left.world().gop.fence(); // Is this still essential?  Yes.
-            vresult[0]->mulXXvec(left.get_impl().get(), vright, vresult, tol, fence);
+            vresult[0]->mulXXvec(left.get_impl().get(), vright, vresult, tol, fence, truncate_on_mul);
         }
 
         /// Same as \c operator* but with optional fence and no automatic reconstruction
@@ -1729,10 +1806,11 @@ namespace madness {
     /// already for both left and right.
     template <typename L, typename R, std::size_t D>
     std::vector< Function<TENSOR_RESULT_TYPE(L,R),D> >
-    vmulXX(const Function<L,D>& left, const std::vector< Function<R,D> >& vright, double tol, bool fence=true) {
+    vmulXX(const Function<L,D>& left, const std::vector< Function<R,D> >& vright, double tol, bool fence=true,
+           bool truncate_on_mul=false) {
         if (vright.size() == 0) return std::vector< Function<TENSOR_RESULT_TYPE(L,R),D> >();
         std::vector< Function<TENSOR_RESULT_TYPE(L,R),D> > vresult(vright.size());
-        vresult[0].vmulXX(left, vright, vresult, tol, fence);
+        vresult[0].vmulXX(left, vright, vresult, tol, fence, truncate_on_mul);
         return vresult;
     }
 
@@ -2112,6 +2190,40 @@ namespace madness {
     }
 
 
+    /// Apply operator to a function of definite mirror symmetry
+
+    /// Only the irreducible boxes of the result are computed (up to 1/8 of
+    /// the work for D2h) and the others are filled in as their images.  The
+    /// operator must be invariant under the reflections of \c symmetry , as
+    /// are the Coulomb, BSH and other isotropic convolutions, and \c f must
+    /// transform according to its characters; the result then does too.
+    /// Returns a new function with the same distribution.
+    template <typename opT, typename R, std::size_t NDIM>
+    Function<TENSOR_RESULT_TYPE(typename opT::opT,R), NDIM>
+    apply(const opT& op, const Function<R,NDIM>& f, const MirrorSymmetry<NDIM>& symmetry) {
+    	typedef TENSOR_RESULT_TYPE(typename opT::opT,R) resultT;
+    	Function<R,NDIM>& ff = const_cast< Function<R,NDIM>& >(f);
+    	MADNESS_CHECK(NDIM<=3 and not op.modified() and not op.is_slaterf12);
+    	MADNESS_ASSERT(not f.is_on_demand());
+
+    	ff.reconstruct();
+    	ff.nonstandard(op.doleaves, true);
+
+    	Function<resultT,NDIM> result;
+    	result.set_impl(ff, false);
+    	result.get_impl()->apply(op, *ff.get_impl(), symmetry);
+    	result.reconstruct();
+
+    	if (op.destructive()) {
+    		ff.world().gop.fence();
+    		ff.clear();
+    	} else {
+    		ff.standard();
+    	}
+    	return result;
+    }
+
+
     template <typename opT, typename R, std::size_t NDIM>
     Function<TENSOR_RESULT_TYPE(typename opT::opT,R), NDIM>
     apply_1d_realspace_push(const opT& op, const Function<R,NDIM>& f, int axis, bool fence=true) {
@@ -2307,6 +2419,45 @@ namespace madness {
     }
 
 
+    /// Selects the wavelet order that represents a functor with the fewest coefficients
+
+    /// Smooth functions are cheaper at high order with fewer boxes, cusps
+    /// and steep functions at low order with deeper refinement.  The functor
+    /// is projected for increasing k from \c kmin and the search stops once
+    /// the number of coefficients has grown twice in a row.  Collective.
+    /// @param[in]  functor the function to represent
+    /// @param[in]  kmin    lowest wavelet order tried
+    /// @param[in]  kmax    highest wavelet order tried
+    /// @param[in]  thresh  truncation threshold of the projection
+    /// @param[in]  print_costs print no. of coefficients, boxes and time for each k
+    /// @return the wavelet order with the fewest coefficients
+    template <typename T, std::size_t NDIM>
+    int select_k(World& world, const std::shared_ptr< FunctionFunctorInterface<T,NDIM> >& functor,
+                 int kmin, int kmax, double thresh=FunctionDefaults<NDIM>::get_thresh(),
+                 bool print_costs=false) {
+        PROFILE_FUNC;
+        MADNESS_CHECK(kmin>0 and kmin<=kmax and kmax<=MAXK);
+        int kbest=kmin, nworse=0;
+        std::size_t best=std::numeric_limits<std::size_t>::max();
+        for (int k=kmin; k<=kmax and nworse<2; ++k) {
+            double wall0=wall_time();
+            Function<T,NDIM> f=FunctionFactory<T,NDIM>(world).functor(functor).k(k).thresh(thresh);
+            const std::size_t ncoeff=f.size(), nbox=f.tree_size();
+            if (print_costs and world.rank()==0) {
+                print("select_k: k",k,"coefficients",ncoeff,"boxes",nbox,"time",wall_time()-wall0);
+            }
+            if (ncoeff<best) {
+                best=ncoeff;
+                kbest=k;
+                nworse=0;
+            } else {
+                ++nworse;
+            }
+        }
+        return kbest;
+    }
+
+
     /// Computes the scalar/inner product between two functions
 
     /// In Maple this would be \c int(conjugate(f(x))*g(x),x=-infinity..infinity)
@@ -2512,6 +2663,7 @@ namespace madness {
 }
 /* @} */
 
+#include <madness/mra/checkpoint.h>
 #include <madness/mra/derivative.h>
 #include <madness/mra/operator.h>
 #include <madness/mra/functypedefs.h>
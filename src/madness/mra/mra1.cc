@@ -47,6 +47,18 @@ namespace madness {
     ConcurrentHashMap< hashT, std::shared_ptr< GaussianConvolution1D<double_complex> > >
     GaussianConvolution1DCache<double_complex>::map = ConcurrentHashMap< hashT, std::shared_ptr< GaussianConvolution1D<double_complex> > >();
 
+    template <>
+    std::size_t GaussianConvolution1DCache<double>::memory_budget = 0;
+
+    template <>
+    std::size_t GaussianConvolution1DCache<double_complex>::memory_budget = 0;
+
+    template <>
+    std::string GaussianConvolution1DCache<double>::directory = "";
+
+    template <>
+    std::string GaussianConvolution1DCache<double_complex>::directory = "";
+
 #ifdef FUNCTION_INSTANTIATE_1
 
     template void fcube<double,1>(const Key<1>&, const FunctionFunctorInterface<double,1>&, const Tensor<double>&, Tensor<double>&);
@@ -37,6 +37,7 @@
 #endif
 
 //#define WORLD_INSTANTIATE_STATIC_TEMPLATES
+#include <algorithm>
 #include <memory>
 #include <math.h>
 #include <cmath>
@@ -318,6 +319,7 @@ namespace madness {
             timer_accumulate.print("accumulate");
             timer_target_driven.print("target_driven");
             timer_lr_result.print("result2low_rank");
+            timer_reduce_rank.print("reduce_rank");
         }
     }
 
@@ -327,6 +329,7 @@ namespace madness {
             timer_accumulate.reset();
             timer_target_driven.reset();
             timer_lr_result.reset();
+            timer_reduce_rank.reset();
         }
     }
 
@@ -335,6 +338,7 @@ namespace madness {
     /// If thresh<=0 the default value of this->thresh is used
     template <typename T, std::size_t NDIM>
     void FunctionImpl<T,NDIM>::truncate(double tol, bool fence) {
+        clear_replicas();
         // Cannot put tol into object since it would make a race condition
         if (tol <= 0.0)
             tol = thresh;
@@ -1189,7 +1193,28 @@ namespace madness {
     /// @param[in]  targs   target tensor arguments (threshold and full/low rank)
     template <typename T, std::size_t NDIM>
     void FunctionImpl<T,NDIM>::reduce_rank(const TensorArgs& targs, bool fence) {
-        flo_unary_op_node_inplace(do_reduce_rank(targs),fence);
+        const double wall0=wall_time();
+
+        // The cost of reducing a node's rank grows with the cube of its rank.
+        // Hand the nodes to the threads in batches, the most expensive ones
+        // first, so that the batches are of similar cost and no thread is
+        // left alone with a high rank node at the end.
+        std::vector<nodeT*> nodes;
+        nodes.reserve(coeffs.size());
+        for (typename dcT::iterator it=coeffs.begin(); it!=coeffs.end(); ++it) {
+            if (it->second.has_coeff()) nodes.push_back(&(it->second));
+        }
+        std::sort(nodes.begin(), nodes.end(), [](const nodeT* a, const nodeT* b) {
+            return a->coeff().rank() > b->coeff().rank();
+        });
+
+        typedef Range<typename std::vector<nodeT*>::iterator> rangeT;
+        const int chunksize=std::max(std::size_t(1),nodes.size()/(4*(ThreadPool::size()+1)));
+        world.taskq.for_each<rangeT,do_reduce_rank_batch>(rangeT(nodes.begin(), nodes.end(), chunksize),
+                                                          do_reduce_rank_batch(targs.thresh)).get();
+        timer_reduce_rank.accumulate(wall_time()-wall0);
+
+        if (fence) world.gop.fence();
     }
 
 
@@ -1408,6 +1433,7 @@ namespace madness {
     /// sum all the contributions from all scales after applying an operator in mod-NS form
     template <typename T, std::size_t NDIM>
     void FunctionImpl<T,NDIM>::trickle_down(bool fence) {
+        clear_replicas();
         //            MADNESS_ASSERT(is_redundant());
         nonstandard = compressed = redundant = false;
         //            this->print_size("in trickle_down");
@@ -1463,6 +1489,7 @@ namespace madness {
 
     template <typename T, std::size_t NDIM>
     void FunctionImpl<T,NDIM>::reconstruct(bool fence) {
+        clear_replicas();
         // Must set true here so that successive calls without fence do the right thing
         MADNESS_ASSERT(not is_redundant());
         nonstandard = compressed = redundant = false;
@@ -1481,6 +1508,7 @@ namespace madness {
     /// @param[in] redundant    keep only sum coeffs at all levels, discard difference coeffs
     template <typename T, std::size_t NDIM>
     void FunctionImpl<T,NDIM>::compress(bool nonstandard, bool keepleaves, bool redundant, bool fence) {
+        clear_replicas();
         MADNESS_ASSERT(not is_redundant());
         // Must set true here so that successive calls without fence do the right thing
         this->compressed = true;
@@ -1507,6 +1535,7 @@ namespace madness {
 
         // fast return if possible
         if (is_redundant()) return;
+        clear_replicas();
 
         // NS form might have leaf sum coeffs, but we don't know
         // change to standard compressed form
@@ -1525,6 +1554,7 @@ namespace madness {
     void FunctionImpl<T,NDIM>::undo_redundant(const bool fence) {
 
         if (!is_redundant()) return;
+        clear_replicas();
         redundant = compressed = nonstandard = false;
         flo_unary_op_node_inplace(remove_internal_coeffs(),fence);
     }
@@ -1738,7 +1768,7 @@ namespace madness {
     /// Changes non-standard compressed form to standard compressed form
     template <typename T, std::size_t NDIM>
     void FunctionImpl<T,NDIM>::standard(bool fence) {
-
+        clear_replicas();
         flo_unary_op_node_inplace(do_standard(this),fence);
         nonstandard = false;
     }
@@ -2680,11 +2710,59 @@ namespace madness {
     }
 
 
+    template <typename T, std::size_t NDIM>
+    void FunctionImpl<T,NDIM>::replicate_top(int nlevel, bool fence) {
+        clear_replicas();
+        coeffs.replicate([nlevel](const keyT& key, const nodeT& node) {return key.level() <= nlevel;}, false);
+        replica_level = nlevel;
+        if (fence) world.gop.fence();
+    }
+
+
+    template <typename T, std::size_t NDIM>
+    void FunctionImpl<T,NDIM>::clear_replicas() {
+        if (replica_level < 0) return;
+        coeffs.clear_replicas();
+        replica_level = -1;
+    }
+
+
+    template <typename T, std::size_t NDIM>
+    const FunctionNode<T,NDIM>* FunctionImpl<T,NDIM>::find_replica(keyT& key) const {
+        if (replica_level < 0) return nullptr;
+        keyT k = (key.level() > replica_level) ? key.parent(key.level() - replica_level) : key;
+        while (true) {
+            const nodeT* node = coeffs.find_replica(k);
+            if (node) {
+                // A replicated box with children means that the key is further down
+                if (k != key && node->has_children()) return nullptr;
+                ++replica_nhit;
+                key = k;
+                return node;
+            }
+            if (k.level() == 0) return nullptr;
+            k = k.parent();
+        }
+    }
+
+
+    template <typename T, std::size_t NDIM>
+    std::size_t FunctionImpl<T,NDIM>::replica_hits() const {
+        return replica_nhit + coeffs.replica_hits();
+    }
+
+
     template <typename T, std::size_t NDIM>
     void FunctionImpl<T,NDIM>::sock_it_to_me(const keyT& key,
                                              const RemoteReference< FutureImpl< std::pair<keyT,coeffT> > >& ref) const {
         //PROFILE_MEMBER_FUNC(FunctionImpl);
-        if (coeffs.probe(key)) {
+        keyT found = key;
+        const nodeT* replica = coeffs.probe(key) ? nullptr : find_replica(found);
+        if (replica) {
+            Future< std::pair<keyT,coeffT> > result(ref);
+            result.set(std::pair<keyT,coeffT>(found, replica->has_coeff() ? replica->coeff() : coeffT()));
+        }
+        else if (coeffs.probe(key)) {
             const nodeT& node = coeffs.find(key).get()->second;
             Future< std::pair<keyT,coeffT> > result(ref);
             if (node.has_coeff()) {
@@ -2744,7 +2822,8 @@ namespace madness {
         ProcessID me = world.rank();
         while (1) {
             ProcessID owner = coeffs.owner(key);
-            if (owner != me) {
+            // find() returns the replica of a remote key if there is one
+            if (owner != me && !coeffs.find_replica(key)) {
                 //PROFILE_BLOCK(eval_send); // Too fine grain for routine profiling
                 woT::task(owner, &implT::eval, x, key, ref, TaskAttributes::hipri());
                 return;
@@ -2773,6 +2852,113 @@ namespace madness {
     }
 
 
+    template <typename T, std::size_t NDIM>
+    void FunctionImpl<T,NDIM>::eval_batch(const std::vector< Vector<double,NDIM> >& x,
+                                          const keyT& key,
+                                          const typename Future< std::vector<T> >::remote_refT& ref) {
+
+        PROFILE_MEMBER_FUNC(FunctionImpl);
+        const ProcessID owner = coeffs.owner(key);
+        if (owner != world.rank()) {
+            woT::task(owner, &implT::eval_batch, x, key, ref, TaskAttributes::hipri());
+            return;
+        }
+
+        nodeT& node = coeffs.find(key).get()->second;
+        if (node.has_coeff()) {
+            Future< std::vector<T> >(ref).set(eval_cube_batch(key, x, node.coeff().full_tensor_copy()));
+            return;
+        }
+
+        // sort the points into the children
+        const Level n = key.level()+1;
+        const Vector<Translation,NDIM>& l = key.translation();
+        std::vector< std::vector<long> > index(1<<NDIM);
+        std::vector< std::vector< Vector<double,NDIM> > > xchild(1<<NDIM);
+        for (std::size_t i=0; i<x.size(); ++i) {
+            int c = 0;
+            for (std::size_t d=0; d<NDIM; ++d) {
+                Translation li = Translation(std::ldexp(x[i][d],n)) - 2*l[d];
+                if (li > 1) li = 1;
+                if (li < 0) li = 0;
+                c += li<<d;
+            }
+            index[c].push_back(i);
+            xchild[c].push_back(x[i]);
+        }
+
+        std::vector< Future< std::vector<T> > > v;
+        std::vector< std::vector<long> > vindex;
+        for (int c=0; c<(1<<NDIM); ++c) {
+            if (index[c].empty()) continue;
+            Vector<Translation,NDIM> lc;
+            for (std::size_t d=0; d<NDIM; ++d) lc[d] = 2*l[d] + ((c>>d) & 1);
+            Future< std::vector<T> > result;
+            eval_batch(xchild[c], keyT(n,lc), result.remote_ref(world));
+            v.push_back(result);
+            vindex.push_back(index[c]);
+        }
+        woT::task(world.rank(), &implT::eval_batch_gather, vindex, v, ref);
+    }
+
+
+    template <typename T, std::size_t NDIM>
+    void FunctionImpl<T,NDIM>::eval_batch_gather(const std::vector< std::vector<long> >& index,
+                                                 const std::vector< Future< std::vector<T> > >& v,
+                                                 const typename Future< std::vector<T> >::remote_refT& ref) const {
+        long npt = 0;
+        for (std::size_t c=0; c<index.size(); ++c) npt += index[c].size();
+        std::vector<T> result(npt);
+        for (std::size_t c=0; c<index.size(); ++c) {
+            const std::vector<T>& vc = v[c].get();
+            for (std::size_t j=0; j<index[c].size(); ++j) result[index[c][j]] = vc[j];
+        }
+        Future< std::vector<T> >(ref).set(result);
+    }
+
+
+    template <typename T, std::size_t NDIM>
+    std::vector<T> FunctionImpl<T,NDIM>::eval_cube_batch(const keyT& key,
+            const std::vector< Vector<double,NDIM> >& x, const tensorT& c) const {
+        PROFILE_MEMBER_FUNC(FunctionImpl);
+        const int k = cdata.k;
+        const long npt = x.size();
+        const Level n = key.level();
+
+        // scaling functions of all points, one (npt,k) matrix per dimension
+        std::vector< Tensor<double> > px(NDIM);
+        for (std::size_t d=0; d<NDIM; ++d) {
+            px[d] = Tensor<double>(npt,k);
+            for (long i=0; i<npt; ++i) {
+                double xi = std::ldexp(x[i][d],n) - key.translation()[d];
+                xi = std::min(1.0,std::max(0.0,xi));
+                legendre_scaling_functions(xi,k,&px[d](i,0));
+            }
+        }
+
+        // contract the first dimension for all points at once,
+        // then the remaining ones point by point, last one first
+        Tensor<T> tmp = inner(px[0],c.reshape(k,c.size()/k));
+        const double fac = pow(2.0,0.5*NDIM*n)/sqrt(FunctionDefaults<NDIM>::get_cell_volume());
+        std::vector<T> result(npt);
+        for (long i=0; i<npt; ++i) {
+            T* p = tmp.ptr() + i*tmp.dim(1);
+            long size = tmp.dim(1);
+            for (std::size_t d=NDIM-1; d>0; --d) {
+                const double* pd = px[d].ptr() + i*k;
+                size /= k;
+                for (long r=0; r<size; ++r) {
+                    T sum = T(0.0);
+                    for (int q=0; q<k; ++q) sum += p[r*k+q]*pd[q];
+                    p[r] = sum;
+                }
+            }
+            result[i] = p[0]*fac;
+        }
+        return result;
+    }
+
+
     template <typename T, std::size_t NDIM>
     std::pair<bool,T>
     FunctionImpl<T,NDIM>::eval_local_only(const Vector<double,NDIM>& xin, Level maxlevel) {
@@ -2817,7 +3003,8 @@ namespace madness {
         ProcessID me = world.rank();
         while (1) {
             ProcessID owner = coeffs.owner(key);
-            if (owner != me) {
+            // find() returns the replica of a remote key if there is one
+            if (owner != me && !coeffs.find_replica(key)) {
                 //PROFILE_BLOCK(eval_send); // Too fine grain for routine profiling
                 woT::task(owner, &implT::evaldepthpt, x, key, ref, TaskAttributes::hipri());
                 return;
@@ -3066,6 +3253,11 @@ namespace madness {
     FunctionImpl<T,NDIM>::find_me(const Key<NDIM>& key) const {
         //PROFILE_MEMBER_FUNC(FunctionImpl); // Too fine grain for routine profiling
         typedef std::pair< Key<NDIM>,coeffT > argT;
+        keyT found = key;
+        if (const nodeT* replica = find_replica(found)) {
+            const coeffT c = replica->has_coeff() ? replica->coeff() : nodeT(coeffT(project(found),targs),false).coeff();
+            return Future<argT>(argT(found, c));
+        }
         Future<argT> result;
         //PROFILE_BLOCK(find_me_send); // Too fine grain for routine profiling
         woT::task(coeffs.owner(key), &implT::sock_it_to_me_too, key, result.remote_ref(world), TaskAttributes::hipri());
@@ -3088,7 +3280,8 @@ namespace madness {
                 //PROFILE_BLOCK(compress_send); // Too fine grain for routine profiling
                 // readily available
                 v[i] = woT::task(coeffs.owner(kit.key()), &implT::compress_spawn, kit.key(),
-                                 nonstandard, keepleaves, redundant, TaskAttributes::hipri());
+                                 nonstandard, keepleaves, redundant,
+                                 TaskAttributes::affinity(kit.key().hash(), TaskAttributes::hipri()));
             }
             if (redundant) return woT::task(world.rank(),&implT::make_redundant_op, key, v);
             return woT::task(world.rank(),&implT::compress_op, key, v, nonstandard, redundant);
@@ -3323,6 +3516,7 @@ namespace madness {
         debug = false;
         truncate_on_project = true;
         apply_randomize = false;
+        apply_lowrank = false;
         project_randomize = false;
         bc = BoundaryConditions<NDIM>(BC_FREE);
         tt = TT_FULL;
@@ -3349,6 +3543,7 @@ namespace madness {
     		std::cout << "                           debug" <<  ": " << debug << std::endl;
     		std::cout << "             truncate_on_project" <<  ": " << truncate_on_project << std::endl;
     		std::cout << "                 apply_randomize" <<  ": " << apply_randomize << std::endl;
+    		std::cout << "                   apply_lowrank" <<  ": " << apply_lowrank << std::endl;
     		std::cout << "               project_randomize" <<  ": " << project_randomize << std::endl;
     		std::cout << "                              bc" <<  ": " << bc << std::endl;
     		std::cout << "                              tt" <<  ": " << tt << std::endl;
@@ -3369,6 +3564,7 @@ namespace madness {
     template <std::size_t NDIM> bool FunctionDefaults<NDIM>::debug;
     template <std::size_t NDIM> bool FunctionDefaults<NDIM>::truncate_on_project;
     template <std::size_t NDIM> bool FunctionDefaults<NDIM>::apply_randomize;
+    template <std::size_t NDIM> bool FunctionDefaults<NDIM>::apply_lowrank;
     template <std::size_t NDIM> bool FunctionDefaults<NDIM>::project_randomize;
     template <std::size_t NDIM> BoundaryConditions<NDIM> FunctionDefaults<NDIM>::bc;
     template <std::size_t NDIM> TensorType FunctionDefaults<NDIM>::tt;
@@ -48,6 +48,7 @@
  */
 
 #include <madness/mra/mra.h>
+#include <madness/mra/vmra.h>
 #include <madness/tensor/solvers.h>
 
 namespace madness {
@@ -83,6 +84,154 @@ namespace madness {
 		}
 	}
 
+	template <class T>
+	struct default_allocator {
+        T operator()() {return T();}
+    };
+
+    /// Overlaps of the newest item of a KAIN subspace with the others
+
+    /// On return row(i) = inner(ulist[i],rlist.back()) and col(i) =
+    /// inner(ulist.back(),rlist[i]).  This generic version calls inner()
+    /// 2*ulist.size() times; the overloads for functions and vectors of
+    /// functions compute all overlaps in one pass with a single reduction.
+    template <typename T, typename C>
+    void kain_overlaps(const std::vector<T>& ulist, const std::vector<T>& rlist, Tensor<C>& row, Tensor<C>& col) {
+        const long n = ulist.size();
+        row = Tensor<C>(n);
+        col = Tensor<C>(n);
+        for (long i=0; i<n; i++) {
+            row(i) = inner(ulist[i],rlist[n-1]);
+            col(i) = inner(ulist[n-1],rlist[i]);
+        }
+    }
+
+    /// Overlaps of the newest item of a KAIN subspace of functions with the others
+    template <typename Q, std::size_t NDIM, typename C>
+    void kain_overlaps(const std::vector< Function<Q,NDIM> >& ulist, const std::vector< Function<Q,NDIM> >& rlist,
+                       Tensor<C>& row, Tensor<C>& col) {
+        const long n = ulist.size();
+        std::vector< Function<Q,NDIM> > left(ulist), right(n, rlist.back());
+        left.insert(left.end(), n, ulist.back());
+        right.insert(right.end(), rlist.begin(), rlist.end());
+
+        Tensor<TENSOR_RESULT_TYPE(Q,Q)> r = inner(ulist.back().world(), left, right);
+        row = Tensor<C>(n);
+        col = Tensor<C>(n);
+        for (long i=0; i<n; i++) {
+            row(i) = r(i);
+            col(i) = r(n+i);
+        }
+    }
+
+    /// Overlaps of the newest item of a KAIN subspace of vectors of functions with the others
+    template <typename Q, std::size_t NDIM, typename C>
+    void kain_overlaps(const std::vector< std::vector< Function<Q,NDIM> > >& ulist,
+                       const std::vector< std::vector< Function<Q,NDIM> > >& rlist,
+                       Tensor<C>& row, Tensor<C>& col) {
+        const long n = ulist.size();
+        const long m = ulist.back().size();
+        row = Tensor<C>(n);
+        col = Tensor<C>(n);
+        if (m == 0) return;
+
+        // Item i of the subspace occupies elements i*m,...,(i+1)*m-1
+        std::vector< Function<Q,NDIM> > left, right;
+        for (long i=0; i<n; i++) {
+            MADNESS_CHECK(long(ulist[i].size()) == m && long(rlist[i].size()) == m);
+            left.insert(left.end(), ulist[i].begin(), ulist[i].end());
+            right.insert(right.end(), rlist.back().begin(), rlist.back().end());
+        }
+        for (long i=0; i<n; i++) {
+            left.insert(left.end(), ulist.back().begin(), ulist.back().end());
+            right.insert(right.end(), rlist[i].begin(), rlist[i].end());
+        }
+
+        Tensor<TENSOR_RESULT_TYPE(Q,Q)> r = inner(ulist.back()[0].world(), left, right);
+        for (long i=0; i<n; i++) {
+            row(i) = r(Slice(i*m,(i+1)*m-1)).sum();
+            col(i) = r(Slice((n+i)*m,(n+i+1)*m-1)).sum();
+        }
+    }
+
+    /// New KAIN solution as the combination sum(i) c[i]*(ulist[i]-rlist[i])
+
+    /// This generic version makes two temporaries per term; the overloads
+    /// for functions and vectors of functions form all of the result in a
+    /// single fused transform that reads each function tree once.
+    template <typename T, typename C, typename Alloc>
+    T kain_combination(const std::vector<T>& ulist, const std::vector<T>& rlist, const Tensor<C>& c, Alloc& alloc) {
+        T unew = alloc();
+        for (std::size_t i=0; i<ulist.size(); i++) {
+            unew += (ulist[i] - rlist[i])*c[i];
+        }
+        return unew;
+    }
+
+    /// New KAIN solution from a subspace of functions
+    template <typename Q, std::size_t NDIM, typename C, typename Alloc>
+    Function<Q,NDIM> kain_combination(const std::vector< Function<Q,NDIM> >& ulist,
+                                      const std::vector< Function<Q,NDIM> >& rlist,
+                                      const Tensor<C>& c, Alloc& alloc) {
+        const long n = ulist.size();
+        std::vector< Function<Q,NDIM> > v(ulist);
+        v.insert(v.end(), rlist.begin(), rlist.end());
+        Tensor<C> cc(2*n,1L);
+        for (long i=0; i<n; i++) {
+            cc(i,0L) = c(i);
+            cc(n+i,0L) = -c(i);
+        }
+        return transform(ulist.back().world(), v, cc, 0.0, true)[0];
+    }
+
+    /// New KAIN solution from a subspace of vectors of functions
+    template <typename Q, std::size_t NDIM, typename C, typename Alloc>
+    std::vector< Function<Q,NDIM> > kain_combination(const std::vector< std::vector< Function<Q,NDIM> > >& ulist,
+                                                     const std::vector< std::vector< Function<Q,NDIM> > >& rlist,
+                                                     const Tensor<C>& c, Alloc& alloc) {
+        const long n = ulist.size();
+        const long m = ulist.back().size();
+        if (m == 0) return alloc();
+
+        // Element k of every u and r contributes only to element k of the result
+        std::vector< Function<Q,NDIM> > v;
+        Tensor<C> cc(2*n*m,m);
+        for (long i=0; i<n; i++) {
+            MADNESS_CHECK(long(ulist[i].size()) == m && long(rlist[i].size()) == m);
+            v.insert(v.end(), ulist[i].begin(), ulist[i].end());
+            v.insert(v.end(), rlist[i].begin(), rlist[i].end());
+            for (long k=0; k<m; k++) {
+                cc(2*i*m+k,k) = c(i);
+                cc((2*i+1)*m+k,k) = -c(i);
+            }
+        }
+        return transform(ulist.back()[0].world(), v, cc, 0.0, true);
+    }
+
+    /// Copy of an item for a KAIN subspace stored in compressed form
+
+    /// Items that are not functions, or vectors of functions, are kept as is.
+    template <typename T>
+    T kain_compressed_copy(const T& t) {
+        return t;
+    }
+
+    template <typename Q, std::size_t NDIM>
+    Function<Q,NDIM> kain_compressed_copy(const Function<Q,NDIM>& f) {
+        Function<Q,NDIM> g = copy(f);
+        g.compress();
+        return g;
+    }
+
+    template <typename Q, std::size_t NDIM>
+    std::vector< Function<Q,NDIM> > kain_compressed_copy(const std::vector< Function<Q,NDIM> >& v) {
+        if (v.empty()) return v;
+        World& world = v[0].world();
+        std::vector< Function<Q,NDIM> > w = copy(world, v);
+        compress(world, w);
+        return w;
+    }
+
 	/// A simple Krylov-subspace nonlinear equation solver
 
     /// \ingroup nonlinearsolve
@@ -123,24 +272,19 @@ namespace madness {
 			rlist.push_back(r);
 
 			// Solve subspace equations
-			real_tensor Qnew(iter+1,iter+1);
+			real_tensor Qnew(iter+1,iter+1), row, col;
 			if (iter>0) Qnew(Slice(0,-2),Slice(0,-2)) = Q;
-			for (int i=0; i<=iter; i++) {
-				Qnew(i,iter) = inner(ulist[i],rlist[iter]);
-				Qnew(iter,i) = inner(ulist[iter],rlist[i]);
-			}
+			kain_overlaps(ulist,rlist,row,col);
+			Qnew(_,iter) = row;
+			Qnew(iter,_) = col;
 			Q = Qnew;
 			real_tensor c = KAIN(Q);
 			check_linear_dependence(Q,c,rcondtol,cabsmax);
 			if (do_print) print("subspace solution",c);
 
 			// Form new solution in u
-			Function<double,NDIM> unew = FunctionFactory<double,NDIM>(u.world());
-			if (ulist[0].is_compressed()) unew.compress();
-			for (int i=0; i<=iter; i++) {
-				unew.gaxpy(1.0,ulist[i], c[i]);
-				unew.gaxpy(1.0,rlist[i],-c[i]);
-			}
+			default_allocator< Function<double,NDIM> > alloc;
+			Function<double,NDIM> unew = kain_combination(ulist,rlist,c,alloc);
 			unew.truncate();
 
 			if (ulist.size() == maxsub) {
@@ -156,11 +300,6 @@ namespace madness {
 	typedef NonlinearSolverND<3> NonlinearSolver;
 
 
-	template <class T>
-	struct default_allocator {
-        T operator()() {return T();}
-    };
-    
     /// Generalized version of NonlinearSolver not limited to a single madness function
 
     /// \ingroup nonlinearsolve 
@@ -184,18 +323,21 @@ namespace madness {
         std::vector<T> ulist, rlist; ///< Subspace information
         Tensor<C> Q;
         Tensor<C> c;		///< coefficients for linear combination
+        bool compressed;	///< store compressed copies in the subspace
     public:
         bool do_print;
 
 	XNonlinearSolver(const Alloc& alloc = Alloc(),bool print=false)
             : maxsub(10)
             , alloc(alloc)
+            , compressed(false)
     		, do_print(print)
         {}
 
 	XNonlinearSolver(const XNonlinearSolver& other)
             : maxsub(other.maxsub)
             , alloc(other.alloc)
+            , compressed(other.compressed)
 			, do_print(other.do_print)
         {}
 
@@ -206,6 +348,15 @@ namespace madness {
 	void set_maxsub(int maxsub) {this->maxsub = maxsub;}
 	Tensor<C> get_c() const {return c;}
 
+	/// Store compressed copies of the solutions and residuals in the subspace
+
+	/// By default the subspace shares the caller's functions, which are
+	/// compressed and reconstructed again whenever the caller changes their
+	/// representation.  Compressed copies are made once, stay in the form
+	/// used by the overlaps and the new solution, and are not affected by
+	/// later changes to the caller's functions.
+	void set_compress_subspace(bool flag) {compressed = flag;}
+
 	void clear_subspace() {
 		ulist.clear();
 		rlist.clear();
@@ -225,16 +376,15 @@ namespace madness {
 	T update(const T& u, const T& r, const double rcondtol=1e-8, const double cabsmax=1000.0) {
 		if (maxsub==1) return u-r;
 		int iter = ulist.size();
-		ulist.push_back(u);
-		rlist.push_back(r);
+		ulist.push_back(compressed ? kain_compressed_copy(u) : u);
+		rlist.push_back(compressed ? kain_compressed_copy(r) : r);
 
 		// Solve subspace equations
-		Tensor<C> Qnew(iter+1,iter+1);
+		Tensor<C> Qnew(iter+1,iter+1), row, col;
 		if (iter>0) Qnew(Slice(0,-2),Slice(0,-2)) = Q;
-		for (int i=0; i<=iter; i++) {
-			Qnew(i,iter) = inner(ulist[i],rlist[iter]);
-			Qnew(iter,i) = inner(ulist[iter],rlist[i]);
-		}
+		kain_overlaps(ulist,rlist,row,col);
+		Qnew(_,iter) = row;
+		Qnew(iter,_) = col;
 		Q = Qnew;
 		c = KAIN(Q);
 
@@ -242,10 +392,7 @@ namespace madness {
 		if (do_print) print("subspace solution",c);
 
 		// Form new solution in u
-		T unew = alloc();
-		for (int i=0; i<=iter; i++) {
-			unew += (ulist[i] - rlist[i])*c[i];
-		}
+		T unew = kain_combination(ulist,rlist,c,alloc);
 
 		if (ulist.size() == maxsub) {
 			ulist.erase(ulist.begin());
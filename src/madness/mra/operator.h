@@ -38,6 +38,7 @@
 /// \ingroup function
 
 #include <type_traits>
+#include <set>
 #include <limits.h>
 #include <madness/mra/adquad.h>
 #include <madness/tensor/aligned.h>
@@ -1040,6 +1041,24 @@ namespace madness {
         	}
         }
 
+        /// return the memory held by the cached operator blocks in bytes
+
+        /// includes the blocks of the 1D convolutions, which may be shared
+        /// with other operators
+        std::size_t cache_memory_size() const {
+            auto data_size = [](const SeparatedConvolutionData<Q,NDIM>& d) {
+                return sizeof(d)+d.muops.size()*sizeof(SeparatedConvolutionInternal<Q,NDIM>);
+            };
+            std::size_t total=data.memory_size(data_size)+mod_data.memory_size(data_size);
+
+            std::set<const Convolution1D<Q>*> ops_1d;
+            for (int mu=0; mu<rank; ++mu) {
+                for (std::size_t d=0; d<NDIM; ++d) ops_1d.insert(ops[mu].getop(d).get());
+            }
+            for (const Convolution1D<Q>* op_1d : ops_1d) total+=op_1d->cache_memory_size();
+            return total;
+        }
+
         const BoundaryConditions<NDIM>& get_bc() const {return bc;}
 
         const std::vector< Key<NDIM> >& get_disp(Level n) const {
@@ -1185,6 +1204,129 @@ namespace madness {
         }
 
 
+        /// apply this operator on coefficients in tensor train form
+
+        /// Each separated term is applied to the cores of the tensor train,
+        /// which is cheap if the TT ranks of the coefficients are small
+        /// (cf. estimate_costs_tt), and the transformed train is accumulated
+        /// into a full rank result.
+        /// @param[in]  source  the source key
+        /// @param[in]  shift   the displacement, where the source coeffs come from
+        /// @param[in]  coeff   source NS coeffs (2k)^NDIM in tensor train form
+        /// @param[in]  tol     thresh/#neigh*cnorm
+        /// @return     a tensor of full rank with the result op(coeff)
+        template <typename T>
+        Tensor<TENSOR_RESULT_TYPE(T,Q)> apply_tt(const Key<NDIM>& source,
+                                                 const Key<NDIM>& shift,
+                                                 const TensorTrain<T>& coeff,
+                                                 double tol) const {
+            typedef TENSOR_RESULT_TYPE(T,Q) resultT;
+            MADNESS_ASSERT(not modified());
+            MADNESS_ASSERT(coeff.ndim()==NDIM);
+            MADNESS_ASSERT(coeff.dim(0)==2*k);
+
+            double cpu0=cpu_time();
+
+            tol = 0.01*tol/rank; // Error is per separated term
+            const SeparatedConvolutionData<Q,NDIM>* op = getop(source.level(), shift, source);
+
+            Tensor<resultT> r(v2k), r0(vk);
+            const TensorTrain<T> f0=copy(coeff,s0);
+            Tensor<Q> trans[NDIM];
+
+            for (int mu=0; mu<rank; ++mu) {
+                const SeparatedConvolutionInternal<Q,NDIM>& muop =  op->muops[mu];
+                if (muop.norm > tol) {
+                    const Q fac = ops[mu].getfac();
+
+                    double Rnorm = 1.0;
+                    for (std::size_t d=0; d<NDIM; ++d) Rnorm *= muop.ops[d]->Rnorm;
+                    if (Rnorm > 1.e-20) {
+                        for (std::size_t d=0; d<NDIM; ++d) trans[d]=muop.ops[d]->R;
+                        r.gaxpy(1.0,general_transform(coeff,trans).reconstruct(),fac);
+                    }
+
+                    double Tnorm = 1.0;
+                    for (std::size_t d=0; d<NDIM; ++d) Tnorm *= muop.ops[d]->Tnorm;
+                    if ((source.level()>0) and (Tnorm > 0.0)) {
+                        for (std::size_t d=0; d<NDIM; ++d) trans[d]=muop.ops[d]->T;
+                        r0.gaxpy(1.0,general_transform(f0,trans).reconstruct(),-fac);
+                    }
+                }
+            }
+
+            r(s0).gaxpy(1.0,r0,1.0);
+            double cpu1=cpu_time();
+            timer_low_transf.accumulate(cpu1-cpu0);
+
+            return r;
+        }
+
+        /// estimate the ratio of cost of full rank versus tensor train application
+
+        /// The full rank cost is NDIM matrix multiplications of the (2k)^NDIM
+        /// coefficients per term; the tensor train cost is the transformation
+        /// of the cores plus the reconstruction of the result, both of which
+        /// scale with the TT ranks of the coefficients.
+        /// @param[in]  source  source key
+        /// @param[in]  shift   displacement
+        /// @param[in]  coeff   source NS coeffs in tensor train form
+        /// @param[in]  tol     thresh/#neigh/cnorm
+        /// @return cost_ratio  r=-1:   no terms left
+        ///                     0<r<1:  better to do full rank
+        ///                     1<r:    better to do tensor train
+        template<typename T>
+        double estimate_costs_tt(const Key<NDIM>& source,
+                                 const Key<NDIM>& shift,
+                                 const TensorTrain<T>& coeff,
+                                 double tol) const {
+
+            if (coeff.is_zero_rank()) return 1.5;
+            const SeparatedConvolutionData<Q,NDIM>* op = getop(source.level(), shift, source);
+
+            tol = 0.01*tol/rank; // Error is per separated term
+
+            // cost of transforming and reconstructing a tensor train with
+            // ranks (1,r_1,..,r_{NDIM-1},1) and dimension dimk
+            const std::vector<long> ranks=coeff.ranks();
+            auto tt_cost = [&ranks](const double dimk) {
+                double cost=0.0;
+                double size=1.0;
+                for (std::size_t d=0; d<NDIM; ++d) {
+                    const double rl=(d==0) ? 1.0 : ranks[d-1];
+                    const double rr=(d==NDIM-1) ? 1.0 : ranks[d];
+                    cost+=dimk*dimk*rl*rr;          // transform core d
+                    size*=dimk;
+                    if (d>0) cost+=size*rl*rr;      // merge core d into the result
+                }
+                return cost;
+            };
+
+            const double twok=2.0*k;
+            const double full_operator_cost=NDIM*std::pow(twok,NDIM+1);
+            const double full_operator_cost0=NDIM*std::pow(double(k),NDIM+1);
+            const double low_operator_cost=tt_cost(twok);
+            const double low_operator_cost0=tt_cost(k);
+
+            double full_cost=0.0;
+            double low_cost=0.0;
+            for (int mu=0; mu<rank; ++mu) {
+                if (op->muops[mu].norm > tol) {
+                    full_cost+=full_operator_cost;
+                    low_cost+=low_operator_cost;
+                    if (source.level()>0) {
+                        full_cost+=full_operator_cost0;
+                        low_cost+=low_operator_cost0;
+                    }
+                }
+            }
+
+            double ratio=-1.0;
+            if (low_cost>0.0) ratio=full_cost/low_cost;
+            return ratio;
+        }
+
+
         /// apply this operator on only 1 particle of the coefficients in low rank form
 
         /// note the unfortunate mess with NDIM: here NDIM is the operator dimension, and FDIM is the
@@ -49,6 +49,8 @@ namespace madness {
         mapT cache;
 
     public:
+        typedef typename mapT::const_iterator const_iterator;
+
         SimpleCache() : cache() {};
 
         SimpleCache(const SimpleCache& c) : cache(c.cache) {};
@@ -101,6 +103,41 @@ namespace madness {
             Key<NDIM> key(n,disp.translation());
             set(key, val);
         }
+
+        /// Iterator to the first cached (key,value) pair
+        const_iterator begin() const {
+            return cache.begin();
+        }
+
+        /// Iterator past the last cached (key,value) pair
+        const_iterator end() const {
+            return cache.end();
+        }
+
+        /// Return the number of cached elements
+        std::size_t size() const {
+            return cache.size();
+        }
+
+        /// Remove all cached elements
+
+        /// This invalidates all pointers handed out by getptr, so it must
+        /// only be called when none of them is in use any more
+        void clear() {
+            cache.clear();
+        }
+
+        /// Return the memory held by the cached elements in bytes
+
+        /// @param[in]  nbytes  functor returning the size in bytes of one element
+        template <typename funcT>
+        std::size_t memory_size(const funcT& nbytes) const {
+            std::size_t total=0;
+            for (typename mapT::const_iterator it=cache.begin(); it!=cache.end(); ++it) {
+                total+=sizeof(pairT)+nbytes(it->second);
+            }
+            return total;
+        }
     };
 }
 #endif // MADNESS_MRA_SIMPLECACHE_H__INCLUDED
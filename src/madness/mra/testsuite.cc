@@ -904,6 +904,228 @@ int test_coulomb(World& world) {
     return 1;
 }
 
+int test_coulomb_lowrank(World& world) {
+    typedef Vector<double,3> coordT;
+    bool ok=true;
+    if (world.rank() == 0) {
+        print("\nTest low rank Coulomb operator - type =", archive::get_type_name<double>(),", ndim = 3 (only)\n");
+    }
+
+    // a sigma-type orbital made of two s-like Gaussians on a diatomic
+    const double thresh = 1e-4;
+    FunctionDefaults<3>::set_k(6);
+    FunctionDefaults<3>::set_thresh(thresh);
+    FunctionDefaults<3>::set_refine(true);
+    FunctionDefaults<3>::set_initial_level(2);
+    FunctionDefaults<3>::set_truncate_mode(1);
+    FunctionDefaults<3>::set_cubic_cell(-10,10);
+
+    const double expnt = 2.0;
+    const double coeff = pow(2.0/PI*expnt,0.25*3);
+    coordT center1(0.0), center2(0.0);
+    center1[2]=-0.7;
+    center2[2]=0.7;
+    Function<double,3> f = FunctionFactory<double,3>(world)
+        .functor(std::shared_ptr< FunctionFunctorInterface<double,3> >(new Gaussian<double,3>(center1, expnt, coeff)));
+    Function<double,3> g = FunctionFactory<double,3>(world)
+        .functor(std::shared_ptr< FunctionFunctorInterface<double,3> >(new Gaussian<double,3>(center2, expnt, coeff)));
+    f.gaxpy(1.0,g,1.0);
+    f.truncate();
+
+    SeparatedConvolution<double,3> op = CoulombOperator(world, 1e-3, thresh);
+    apply(op,f);        // fill the operator caches so that the timings are comparable
+
+    FunctionDefaults<3>::set_apply_lowrank(false);
+    START_TIMER;
+    Function<double,3> r_full = apply(op,f);
+    END_TIMER("apply full rank");
+
+    FunctionDefaults<3>::set_apply_lowrank(true);
+    START_TIMER;
+    Function<double,3> r_low = apply(op,f);
+    END_TIMER("apply low rank");
+    FunctionDefaults<3>::set_apply_lowrank(false);
+
+    double err = (r_full-r_low).norm2();
+    if (world.rank() == 0) print("  low rank vs full rank", err);
+    CHECK(err, 10.0*thresh, "test_coulomb_lowrank");
+
+    world.gop.fence();
+    if (ok) return 0;
+    return 1;
+}
+
+int test_coulomb_symmetry(World& world) {
+    typedef Vector<double,3> coordT;
+    bool ok=true;
+    if (world.rank() == 0) {
+        print("\nTest Coulomb operator with mirror symmetry - type =", archive::get_type_name<double>(),", ndim = 3 (only)\n");
+    }
+
+    // a sigma_u orbital made of two s-like Gaussians on a diatomic, B1u in D2h
+    const double thresh = 1e-4;
+    FunctionDefaults<3>::set_k(6);
+    FunctionDefaults<3>::set_thresh(thresh);
+    FunctionDefaults<3>::set_refine(true);
+    FunctionDefaults<3>::set_initial_level(2);
+    FunctionDefaults<3>::set_truncate_mode(1);
+    FunctionDefaults<3>::set_cubic_cell(-10,10);
+
+    const double expnt = 2.0;
+    const double coeff = pow(2.0/PI*expnt,0.25*3);
+    coordT center1(0.0), center2(0.0);
+    center1[2]=-0.7;
+    center2[2]=0.7;
+    Function<double,3> f = FunctionFactory<double,3>(world)
+        .functor(std::shared_ptr< FunctionFunctorInterface<double,3> >(new Gaussian<double,3>(center1, expnt, coeff)));
+    Function<double,3> g = FunctionFactory<double,3>(world)
+        .functor(std::shared_ptr< FunctionFunctorInterface<double,3> >(new Gaussian<double,3>(center2, expnt, coeff)));
+    f -= g;
+    f.truncate();
+
+    MirrorSymmetry<3> b1u;
+    b1u.add({-1,-1, 1}, 1).add({-1, 1,-1},-1).add({ 1,-1,-1},-1).add({-1,-1,-1},-1)
+       .add({ 1, 1,-1},-1).add({ 1,-1, 1}, 1).add({-1, 1, 1}, 1);
+
+    SeparatedConvolution<double,3> op = CoulombOperator(world, 1e-3, thresh);
+    apply(op,f);        // fill the operator caches so that the timings are comparable
+
+    START_TIMER;
+    Function<double,3> r_full = apply(op,f);
+    END_TIMER("apply full");
+
+    START_TIMER;
+    Function<double,3> r_sym = apply(op,f,b1u);
+    END_TIMER("apply irreducible boxes");
+
+    double err = (r_full-r_sym).norm2();
+    if (world.rank() == 0) print("  irreducible vs full", err, r_full.tree_size(), r_sym.tree_size());
+    CHECK(err, 10.0*thresh, "test_coulomb_symmetry");
+
+    // a wrong character must not go unnoticed
+    MirrorSymmetry<3> ag;
+    ag.add({-1,-1, 1}, 1).add({-1, 1,-1}, 1).add({ 1,-1,-1}, 1).add({-1,-1,-1}, 1)
+      .add({ 1, 1,-1}, 1).add({ 1,-1, 1}, 1).add({-1, 1, 1}, 1);
+    double wrong = (r_full-apply(op,f,ag)).norm2();
+    if (world.rank() == 0) print("  wrong irrep", wrong);
+    if (wrong < 0.1*r_full.norm2()) ok = false;
+
+    world.gop.fence();
+    if (ok) return 0;
+    return 1;
+}
+
+int test_operator_cache(World& world) {
+    typedef Vector<double,3> coordT;
+    bool ok=true;
+    if (world.rank() == 0) {
+        print("\nTest operator cache - type =", archive::get_type_name<double>(),", ndim = 3 (only)\n");
+    }
+
+    const double thresh = 1e-4;
+    FunctionDefaults<3>::set_k(6);
+    FunctionDefaults<3>::set_thresh(thresh);
+    FunctionDefaults<3>::set_refine(true);
+    FunctionDefaults<3>::set_initial_level(2);
+    FunctionDefaults<3>::set_truncate_mode(1);
+    FunctionDefaults<3>::set_cubic_cell(-10,10);
+
+    const double expnt = 2.0;
+    const double coeff = pow(2.0/PI*expnt,0.25*3);
+    Function<double,3> f = FunctionFactory<double,3>(world)
+        .functor(std::shared_ptr< FunctionFunctorInterface<double,3> >(new Gaussian<double,3>(coordT(0.0), expnt, coeff)));
+
+    // operators of earlier tests are gone: nothing in the cache is in use
+    GaussianConvolution1DCache<double>::evict_unused();
+    CHECK(double(GaussianConvolution1DCache<double>::memory_size()), 1.e-10, "empty operator cache");
+
+    // BSH operators for a sequence of energies, as in an SCF iteration
+    for (double energy : {-0.5, -0.6, -0.7}) {
+        SeparatedConvolution<double,3> op = BSHOperator3D(world, sqrt(-2.0*energy), 1e-3, thresh);
+        Function<double,3> r = apply(op,f);
+        std::size_t opsize=op.cache_memory_size();
+        if (world.rank() == 0) print("  operator cache for energy",energy,opsize,"bytes; total",
+                GaussianConvolution1DCache<double>::memory_size(),"bytes");
+        CHECK(double(opsize==0), 0.5, "operator cache size");
+    }
+
+    std::size_t released=GaussianConvolution1DCache<double>::evict_unused();
+    if (world.rank() == 0) print("  released",released,"bytes of stale operator blocks");
+    CHECK(double(released==0), 0.5, "evict stale operator blocks");
+    CHECK(double(GaussianConvolution1DCache<double>::memory_size()), 1.e-10, "operator cache after eviction");
+
+    world.gop.fence();
+    if (ok) return 0;
+    return 1;
+}
+
+int test_operator_disk_cache(World& world) {
+    typedef Vector<double,3> coordT;
+    typedef GaussianConvolution1DCache<double> cacheT;
+    bool ok=true;
+    if (world.rank() == 0) {
+        print("\nTest persistent operator cache - type =", archive::get_type_name<double>(),", ndim = 3 (only)\n");
+    }
+
+    const double thresh = 1e-6;
+    FunctionDefaults<3>::set_k(8);
+    FunctionDefaults<3>::set_thresh(thresh);
+    FunctionDefaults<3>::set_refine(true);
+    FunctionDefaults<3>::set_initial_level(2);
+    FunctionDefaults<3>::set_truncate_mode(1);
+    FunctionDefaults<3>::set_cubic_cell(-10,10);
+
+    const double expnt = 2.0;
+    const double coeff = pow(2.0/PI*expnt,0.25*3);
+    Function<double,3> f = FunctionFactory<double,3>(world)
+        .functor(std::shared_ptr< FunctionFunctorInterface<double,3> >(new Gaussian<double,3>(coordT(0.0), expnt, coeff)));
+
+    cacheT::evict_unused();
+    cacheT::set_cache_directory(".");
+
+    // time to first apply with all operator blocks computed from scratch
+    Function<double,3> r1;
+    {
+        START_TIMER;
+        SeparatedConvolution<double,3> op = CoulombOperator(world, 1e-4, thresh);
+        r1 = apply(op,f);
+        END_TIMER("first apply, cold");
+    }
+    world.gop.fence();
+    if (world.rank()==0) cacheT::store();
+    world.gop.fence();
+    cacheT::evict_unused();
+
+    // time to first apply with the rnlp blocks read from disk
+    Function<double,3> r2;
+    {
+        START_TIMER;
+        SeparatedConvolution<double,3> op = CoulombOperator(world, 1e-4, thresh);
+        r2 = apply(op,f);
+        END_TIMER("first apply, from disk");
+        START_TIMER;
+        r2 = apply(op,f);
+        END_TIMER("second apply");
+    }
+    world.gop.fence();
+
+    double err = (r1-r2).norm2();
+    if (world.rank() == 0) print("  cold vs from disk", err);
+    CHECK(err, 1.e-12, "test_operator_disk_cache");
+
+    if (world.rank()==0) {
+        for (cacheT::iterator it=cacheT::map.begin(); it!=cacheT::map.end(); ++it) {
+            std::remove(cacheT::filename(it->first).c_str());
+        }
+    }
+    world.gop.fence();
+    cacheT::set_cache_directory("");
+    cacheT::evict_unused();
+
+    if (ok) return 0;
+    return 1;
+}
+
 class QMtest : public FunctionFunctorInterface<double_complex,1> {
 public:
     typedef Vector<double,1> coordT;
@@ -1150,11 +1372,19 @@ int test_plot(World& world) {
     std::size_t maxlevel = f.max_local_depth();
     if (world.rank() == 0) {
         const double h = (2.0*L - 12e-13)/(npt[0]-1.0);
+        std::vector<coordT> xbatch(npt[0]);
+        for (int i=0; i<npt[0]; ++i) xbatch[i] = coordT(-L + i*h + 2e-13);
+        std::vector<T> fbatch = f.eval(xbatch).get();
+        CHECK(double(fbatch.size())-npt[0],0.5,"eval batch size");
+
         for (int i=0; i<npt[0]; ++i) {
             double x = -L + i*h + 2e-13;
 
             T fnum  = f.eval(coordT(x)).get();
 
+            // this checks if the batched evaluation agrees
+            CHECK(fnum-fbatch[i],1e-12,"eval batch");
+
             // this checks if the numerical representation is consistent
             std::pair<bool,T> fnum2 = f.eval_local_only(coordT(x),maxlevel);
             if (world.size() == 1 && !fnum2.first) print("eval_local_only: non-local but nproc=1!");
@@ -1178,6 +1408,11 @@ int test_plot(World& world) {
     plot_line("testline2", 101, coordT(-L), coordT(L), f, f*f);
     plot_line("testline3", 101, coordT(-L), coordT(L), f, f*f, 2.0*f);
 
+    if (NDIM<=3) {
+        plotvti(f, "f", "testplot_vti", coordT(-L), coordT(L), Vector<long,NDIM>(21));
+        plotvtu_tree(f, "f", "testplot_vtu");
+    }
+
     if (world.rank() == 0) print("evaluation of cube/slice for plotting OK", ok);
     if (ok) return 0;
     return 1;
@@ -1222,6 +1457,36 @@ int test_io(World& world) {
     if (world.rank() == 0) print("err = ", err);
     CHECK(err,1e-12,"test_io");
 
+    // Background checkpoint; f is modified while its snapshot is written
+    {
+        Function<T,NDIM> f0 = copy(f);
+        CheckpointWriter checkpoint(world);
+        checkpoint.save(std::vector< Function<T,NDIM> >{f, f0}, "martha");
+        f.compress();
+        f.scale(T(2.0));
+        checkpoint.wait();
+        world.gop.fence();
+
+        std::vector< Function<T,NDIM> > v = load_checkpoint<T,NDIM>(world, "martha");
+        err = (v[0]-f0).norm2() + (v[1]-f0).norm2();
+        if (world.rank() == 0) print("err = ", err);
+        CHECK(err,1e-12,"test_io checkpoint");
+
+        // Over the memory budget the checkpoint is written synchronously
+        CheckpointWriter small(world, 0);
+        small.save(f, "martha");
+        small.wait();
+        world.gop.fence();
+
+        load_checkpoint(world, g, "martha");
+        CHECK(g.is_compressed() ? 0.0 : 1.0,1e-12,"test_io checkpoint tree state");
+        err = (g-f).norm2();
+        if (world.rank() == 0) print("err = ", err);
+        CHECK(err,1e-12,"test_io checkpoint synchronous");
+        world.gop.fence();
+        std::remove(CheckpointWriter::local_filename("martha", world.rank()).c_str());
+    }
+
     //    MADNESS_CHECK(err == 0.0);
 
     if (world.rank() == 0) print("test_io OK");
@@ -1282,6 +1547,86 @@ int test_apply_push_1d(World& world) {
 }
 
 
+template <typename T, std::size_t NDIM>
+int test_select_k(World& world) {
+    typedef Vector<double,NDIM> coordT;
+    typedef std::shared_ptr< FunctionFunctorInterface<T,NDIM> > functorT;
+
+    bool ok=true;
+    if (world.rank() == 0)
+        print("\nTest select_k, type =",archive::get_type_name<T>(),", ndim =",NDIM);
+
+    FunctionDefaults<NDIM>::set_cubic_cell(-10.0,10.0);
+    FunctionDefaults<NDIM>::set_refine(true);
+    FunctionDefaults<NDIM>::set_initial_level(2);
+    const double thresh=1e-8;
+
+    const coordT origin(0.0);
+    const double expnt = 1.0;
+    const double coeff = pow(1.0/PI,0.5*NDIM);
+    functorT functor(new Gaussian<T,NDIM>(origin, expnt, coeff));
+
+    const int kmin=4, kmax=12;
+    int k=select_k(world, functor, kmin, kmax, thresh, world.rank()==0);
+    Function<T,NDIM> fbest=FunctionFactory<T,NDIM>(world).functor(functor).k(k).thresh(thresh);
+    Function<T,NDIM> fmin=FunctionFactory<T,NDIM>(world).functor(functor).k(kmin).thresh(thresh);
+    const std::size_t nbest=fbest.size(), nmin=fmin.size();
+    if (world.rank() == 0) print("  selected k",k,"coefficients",nbest,"at k =",kmin,nmin);
+    if (k<kmin or k>kmax or nbest>nmin) ok=false;
+    // a smooth function at tight threshold favours high order
+    if (k==kmin) ok=false;
+
+    world.gop.fence();
+    if (ok) return 0;
+    return 1;
+}
+
+template <typename T, std::size_t NDIM>
+int test_replicate_top(World& world) {
+    typedef Vector<double,NDIM> coordT;
+    typedef std::shared_ptr< FunctionFunctorInterface<T,NDIM> > functorT;
+
+    bool ok=true;
+    if (world.rank() == 0)
+        print("\nTest replicate_top, type =",archive::get_type_name<T>(),", ndim =",NDIM);
+
+    FunctionDefaults<NDIM>::set_cubic_cell(-10.0,10.0);
+    FunctionDefaults<NDIM>::set_k(8);
+    FunctionDefaults<NDIM>::set_thresh(1.e-8);
+    FunctionDefaults<NDIM>::set_refine(true);
+    FunctionDefaults<NDIM>::set_initial_level(2);
+
+    const coordT origin(0.0);
+    functorT functor(new Gaussian<T,NDIM>(origin, 1.0, pow(1.0/PI,0.5*NDIM)));
+    Function<T,NDIM> f = FunctionFactory<T,NDIM>(world).functor(functor);
+    Derivative<T,NDIM> D(world, 0);
+
+    Function<T,NDIM> df0 = D(f);
+    const coordT r(0.3);
+    const T f0 = f(r);
+
+    // tree walks through the replicated levels must give identical results
+    f.replicate_top(3);
+    Function<T,NDIM> df1 = D(f);
+    const T f1 = f(r);
+    const double err = (df1 - df0).norm2();
+    const std::size_t nreplica = f.get_impl()->get_coeffs().replica_size();
+    std::size_t nhit = f.replica_hits();
+    world.gop.sum(nhit);
+    if (world.rank() == 0) print("  replicas",nreplica,"hits",nhit,"error",err,std::abs(f1-f0));
+    if (err > 1.e-14 or std::abs(f1-f0) > 1.e-14) ok=false;
+    if (world.size() > 1 and nhit == 0) ok=false;
+
+    // modifying the function discards the replicas
+    f.truncate();
+    if (f.get_impl()->get_coeffs().replica_size() != 0) ok=false;
+
+    world.gop.fence();
+    if (ok) return 0;
+    return 1;
+}
+
+
 #define TO_STRING(s) TO_STRING2(s)
 #define TO_STRING2(s) #s
 
@@ -1342,6 +1687,8 @@ int main(int argc, char**argv) {
         nfail+=test_op<double,1>(world);
         nfail+=test_plot<double,1>(world);
         nfail+=test_apply_push_1d<double,1>(world);
+        nfail+=test_select_k<double,1>(world);
+        nfail+=test_replicate_top<double,1>(world);
         nfail+=test_io<double,1>(world);
 
         // stupid location for this test
@@ -1380,6 +1727,10 @@ int main(int argc, char**argv) {
             nfail+=test_diff<double,3>(world);
             nfail+=test_op<double,3>(world);
             nfail+=test_coulomb(world);
+            nfail+=test_coulomb_lowrank(world);
+            nfail+=test_coulomb_symmetry(world);
+            nfail+=test_operator_cache(world);
+            nfail+=test_operator_disk_cache(world);
             nfail+=test_plot<double,3>(world);
             nfail+=test_io<double,3>(world);
             
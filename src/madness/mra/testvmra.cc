@@ -1,6 +1,7 @@
 #define NO_GENTENSOR
 #include <madness/mra/mra.h>
 #include <madness/mra/vmra.h>
+#include <madness/mra/nonlinsol.h>
 #include <madness/misc/ran.h>
 
 const double PI = 3.1415926535897932384;
@@ -302,6 +303,110 @@ void test_rot(World& world) {
 }
 
 
+template <typename T, std::size_t NDIM>
+void test_mul_sparse_truncate(World& world) {
+    typedef std::shared_ptr< FunctionFunctorInterface<T,NDIM> > ffunctorT;
+
+    const double thresh=1.e-5;
+    FunctionDefaults<NDIM>::set_cubic_cell(-10.0,10.0);
+    FunctionDefaults<NDIM>::set_k(6);
+    FunctionDefaults<NDIM>::set_thresh(thresh);
+    FunctionDefaults<NDIM>::set_refine(true);
+    FunctionDefaults<NDIM>::set_initial_level(3);
+    FunctionDefaults<NDIM>::set_truncate_mode(1);
+
+    const int nright=4;
+
+    if (world.rank() == 0)
+        print("testing mul_sparse with truncation on the fly <",archive::get_type_name<T>(),",",NDIM,">");
+
+    // overlapping Gaussians of increasing exponent, as orbital products in exchange
+    const Vector<double,NDIM> origin(0.0);
+    ffunctorT fa(new Gaussian<T,NDIM>(origin,1.0,1.0));
+    Function<T,NDIM> a = FunctionFactory<T,NDIM>(world).functor(fa);
+    std::vector< Function<T,NDIM> > right(nright);
+    for (int i=0; i<nright; ++i) {
+        const Vector<double,NDIM> center(0.3*i);
+        ffunctorT f(new Gaussian<T,NDIM>(center,pow(10.0,i),1.0));
+        right[i] = FunctionFactory<T,NDIM>(world).functor(f);
+    }
+
+    START_TIMER;
+    std::vector< Function<T,NDIM> > result1=mul_sparse(world,a,right,thresh);
+    END_TIMER("mul_sparse");
+    std::size_t size1=0;
+    for (int i=0; i<nright; ++i) size1+=result1[i].tree_size();
+    START_TIMER;
+    truncate(world,result1);
+    END_TIMER("truncate");
+
+    START_TIMER;
+    std::vector< Function<T,NDIM> > result2=mul_sparse(world,a,right,thresh,true,true);
+    END_TIMER("mul_sparse fused");
+
+    std::size_t nbox1=0, nbox2=0;
+    for (int i=0; i<nright; ++i) {
+        nbox1+=result1[i].tree_size();
+        nbox2+=result2[i].tree_size();
+    }
+    double err=norm2(world,sub(world,result1,result2));
+    if (world.rank() == 0) print("boxes untruncated",size1,"truncated",nbox1,"fused",nbox2,"error",err,"\n");
+    MADNESS_CHECK(err < 10.0*thresh);
+    MADNESS_CHECK(nbox2 <= nbox1);
+}
+
+
+template <typename T, std::size_t NDIM>
+void test_kain(World& world) {
+    typedef std::shared_ptr< FunctionFunctorInterface<T,NDIM> > ffunctorT;
+    typedef std::vector< Function<T,NDIM> > vecfuncT;
+
+    FunctionDefaults<NDIM>::set_cubic_cell(-10.0,10.0);
+    FunctionDefaults<NDIM>::set_k(6);
+    FunctionDefaults<NDIM>::set_thresh(1.e-6);
+    FunctionDefaults<NDIM>::set_refine(true);
+    FunctionDefaults<NDIM>::set_initial_level(3);
+    FunctionDefaults<NDIM>::set_truncate_mode(1);
+
+    if (world.rank() == 0)
+        print("testing batched KAIN overlaps and combination <",archive::get_type_name<T>(),",",NDIM,">");
+
+    // subspace of 4 solutions and residuals, each a vector of 3 functions
+    const int nsub=4, m=3;
+    std::vector<vecfuncT> ulist(nsub), rlist(nsub);
+    for (int i=0; i<nsub; ++i) {
+        for (int k=0; k<m; ++k) {
+            ffunctorT fu(RandomGaussian<T,NDIM>(FunctionDefaults<NDIM>::get_cell(),100.0));
+            ffunctorT fr(RandomGaussian<T,NDIM>(FunctionDefaults<NDIM>::get_cell(),100.0));
+            ulist[i].push_back(FunctionFactory<T,NDIM>(world).functor(fu));
+            rlist[i].push_back(FunctionFactory<T,NDIM>(world).functor(fr));
+        }
+    }
+
+    Tensor<T> row, col, c(nsub);
+    kain_overlaps(ulist,rlist,row,col);
+    double err=0.0;
+    for (int i=0; i<nsub; ++i) {
+        err+=std::abs(row(i)-inner(ulist[i],rlist.back()));
+        err+=std::abs(col(i)-inner(ulist.back(),rlist[i]));
+        c(i)=T(0.5*i-0.7);
+    }
+
+    default_allocator<vecfuncT> alloc;
+    vecfuncT unew=kain_combination(ulist,rlist,c,alloc);
+    vecfuncT uref=zero_functions_compressed<T,NDIM>(world,m);
+    for (int i=0; i<nsub; ++i) {
+        gaxpy(world,T(1.0),uref,c(i),ulist[i]);
+        gaxpy(world,T(1.0),uref,-c(i),rlist[i]);
+    }
+    double errc=norm2(world,sub(world,unew,uref));
+
+    if (world.rank() == 0) print("error in overlaps",err,"error in combination",errc,"\n");
+    MADNESS_CHECK(err < 1.e-10);
+    MADNESS_CHECK(errc < 1.e-10);
+}
+
+
 template <std::size_t NDIM>
 void test_multi_to_multi_op(World& world) {
 
@@ -374,6 +479,10 @@ int main(int argc, char**argv) {
         test_rot<double,3>(world);
         test_rot<std::complex<double>,3>(world);
 
+        test_mul_sparse_truncate<double,3>(world);
+
+        test_kain<double,2>(world);
+
         if (!smalltest) test_multi_to_multi_op<3>(world);
 #if !HAVE_GENTENSOR
         test_inner<double,std::complex<double>,1,false>(world);
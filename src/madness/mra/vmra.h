@@ -856,13 +856,19 @@ namespace madness {
     }
 
     /// Multiplies a function against a vector of functions using sparsity of a and v[i] --- q[i] = a * v[i]
+
+    /// With \c truncate_on_mul the products are truncated bottom-up while
+    /// they are formed, which gives the same result as a subsequent
+    /// truncate() but never holds the untruncated product trees.  The
+    /// products are then left reconstructed instead of compressed.
     template <typename T, typename R, std::size_t NDIM>
     std::vector< Function<TENSOR_RESULT_TYPE(T,R), NDIM> >
     mul_sparse(World& world,
                const Function<T,NDIM>& a,
                const std::vector< Function<R,NDIM> >& v,
                double tol,
-               bool fence=true) {
+               bool fence=true,
+               bool truncate_on_mul=false) {
         PROFILE_BLOCK(Vmulsp);
         a.reconstruct(false);
         reconstruct(world, v, false);
@@ -871,7 +877,7 @@ namespace madness {
             v[i].norm_tree(false);
         }
         a.norm_tree();
-        return vmulXX(a, v, tol, fence);
+        return vmulXX(a, v, tol, fence, truncate_on_mul);
     }
 
     /// Makes the norm tree for all functions in a vector
@@ -0,0 +1,105 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+
+/// \file bench_tensor.cc
+/// \brief Benchmarks of the matrix multiplication and transformation kernels
+
+/// Run with \c --json=file to keep the results and \c --quick to only
+/// check that the benchmarks run.
+
+#include <madness/world/MADworld.h>
+#include <madness/world/benchmark.h>
+#include <madness/tensor/tensor.h>
+#include <madness/tensor/mxm.h>
+#include <string>
+#include <vector>
+
+using namespace madness;
+
+/// mTxmq in the shapes used to transform one dimension of a tensor of order ndim
+void bench_mtxmq(BenchmarkRecorder& bench, long k, long ndim) {
+    long dimi = 1;
+    for (long d=1; d<ndim; ++d) dimi *= k;
+    const long dimj = k, dimk = k;
+    const double flops = 2.0*dimi*dimj*dimk;
+    const long niter = std::max(1l, long((bench.quick() ? 1e6 : 1e8)/flops));
+
+    Tensor<double> a(dimk,dimi), b(dimk,dimj), c(dimi,dimj);
+    a.fillrandom();
+    b.fillrandom();
+
+    bench.run("mTxmq " + std::to_string(ndim) + "D k=" + std::to_string(k), [&] {
+        for (long i=0; i<niter; ++i) mTxmq(dimi, dimj, dimk, c.ptr(), a.ptr(), b.ptr());
+    }, 10, flops*niter, "flop");
+}
+
+/// fast_transform of a cube of side k by a k by k matrix
+void bench_fast_transform(BenchmarkRecorder& bench, long k, long ndim) {
+    std::vector<long> dims(ndim, k);
+    Tensor<double> t(dims), result(dims), work(dims), c(k,k);
+    t.fillrandom();
+    c.fillrandom();
+    const double flops = 2.0*ndim*t.size()*k;
+    const long niter = std::max(1l, long((bench.quick() ? 1e6 : 1e8)/flops));
+
+    bench.run("fast_transform " + std::to_string(ndim) + "D k=" + std::to_string(k), [&] {
+        for (long i=0; i<niter; ++i) fast_transform(t, c, result, work);
+    }, 10, flops*niter, "flop");
+}
+
+int main(int argc, char** argv) {
+    World& world = initialize(argc, argv);
+    {
+        BenchmarkRecorder bench(world, "tensor", argc, argv);
+        const std::vector<long> ks = bench.quick() ? std::vector<long>{6,10} :
+                                                     std::vector<long>{6,8,10,12,14,16,20};
+        // 2k is the size of the coefficients in the non-standard form
+        for (long k : ks) {
+            bench_mtxmq(bench, k, 3);
+            bench_mtxmq(bench, 2*k, 3);
+        }
+        for (long k : ks) {
+            if (k <= 10) bench_mtxmq(bench, k, 6);
+        }
+        for (long k : ks) {
+            bench_fast_transform(bench, k, 3);
+            bench_fast_transform(bench, 2*k, 3);
+        }
+        for (long k : ks) {
+            if (k <= 10) bench_fast_transform(bench, k, 6);
+        }
+        bench.write();
+        world.gop.fence();
+    }
+    finalize();
+    return 0;
+}
@@ -0,0 +1,334 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_TENSOR_DISTRIBUTED_EIGEN_H__INCLUDED
+#define MADNESS_TENSOR_DISTRIBUTED_EIGEN_H__INCLUDED
+
+/// \file distributed_eigen.h
+/// \brief Eigensolver and orthonormalization of column-distributed real symmetric matrices
+
+/// All routines are collective and built from systolic loops over the
+/// rows of column-distributed matrices, hence no process ever holds more
+/// than its own rows.  Eigenvectors are returned as the *rows* of a
+/// column-distributed matrix, i.e., \c A=V^T*diag(e)*V .
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <madness/world/MADworld.h>
+#include <madness/tensor/tensor.h>
+#include <madness/tensor/distributed_matrix.h>
+#include <madness/tensor/systolic.h>
+
+namespace madness {
+
+    /// One-sided (Hestenes) Jacobi eigensolver for a positive semi-definite matrix
+
+    /// Row \c i of the matrix holds \c [b_i,v_i] where \c b is the (n,n)
+    /// matrix and \c v is initially the identity.  Plane rotations make the
+    /// rows of \c b mutually orthogonal and are accumulated into \c v .
+    /// Upon convergence row \c i of \c v is an eigenvector and the norm of
+    /// row \c i of \c b the corresponding eigenvalue.  Pairs of rows that
+    /// are out of order are exchanged so that the eigenvalues end up in
+    /// ascending order.
+    template <typename T>
+    class SystolicJacobiEigensolver : public SystolicMatrixAlgorithm<T> {
+        const int64_t n;
+        const T tol;                    ///< Rotate if |b_i.b_j| > tol*|b_i|*|b_j|
+        const int maxsweep;
+        int& nsweep;                    ///< No. of sweeps so far, -1 if not converged
+        AtomicInt nchange;              ///< No. of rotations and exchanges in this sweep
+
+    public:
+        /// @param[in,out] A The (n,2n) matrix \c [b,v]
+        /// @param[in] tol Relative threshold on the overlap of rows
+        /// @param[out] nsweep On return the no. of sweeps, or -1 if not converged
+        /// @param[in] maxsweep Maximum no. of sweeps
+        /// @param[in] tag The MPI tag used for communication
+        SystolicJacobiEigensolver(DistributedMatrix<T>& A, T tol, int& nsweep, int maxsweep=60, int tag=5557)
+            : SystolicMatrixAlgorithm<T>(A, tag)
+            , n(A.coldim())
+            , tol(tol)
+            , maxsweep(maxsweep)
+            , nsweep(nsweep)
+        {
+            MADNESS_ASSERT(A.rowdim() == 2*n);
+            nsweep = 0;
+            nchange = 0;
+        }
+
+        void start_iteration_hook(const TaskThreadEnv& env) {
+            if (env.id() == 0) nchange = 0;
+        }
+
+        void end_iteration_hook(const TaskThreadEnv& env) {
+            if (env.id() == 0) {
+                int nc = nchange;
+                SystolicMatrixAlgorithm<T>::get_world().gop.sum(nc);
+                nchange = nc;
+                ++nsweep;
+                if (nc && nsweep >= maxsweep) nsweep = -1;
+            }
+        }
+
+        bool converged(const TaskThreadEnv& env) const {
+            return nchange == 0 || nsweep < 0;
+        }
+
+        void kernel(int i, int j, T* MADNESS_RESTRICT rowi, T* MADNESS_RESTRICT rowj) {
+            T a = 0, b = 0, c = 0;
+            for (int64_t k=0; k<n; ++k) {
+                a += rowi[k]*rowi[k];
+                b += rowj[k]*rowj[k];
+                c += rowi[k]*rowj[k];
+            }
+
+            if (std::abs(c) > tol*std::sqrt(a*b)) {
+                nchange++;
+                const T zeta = (b - a)/(2*c);
+                const T t = (zeta >= 0 ? T(1) : T(-1))/(std::abs(zeta) + std::sqrt(1 + zeta*zeta));
+                const T cs = 1/std::sqrt(1 + t*t);
+                const T sn = cs*t;
+                for (int64_t k=0; k<2*n; ++k) {
+                    const T x = rowi[k], y = rowj[k];
+                    rowi[k] = cs*x - sn*y;
+                    rowj[k] = sn*x + cs*y;
+                }
+                a -= t*c;
+                b += t*c;
+            }
+
+            // The row with the lower index should have the smaller norm
+            if ((i < j) ? (a > b) : (b > a)) {
+                nchange++;
+                std::swap_ranges(rowi, rowi+2*n, rowj);
+            }
+        }
+    };
+
+
+    /// Transposes in place the (n,n) matrix held in columns \c [off,off+n) of an (n,*) matrix
+    template <typename T>
+    class SystolicTranspose : public SystolicMatrixAlgorithm<T> {
+        const int64_t off;
+
+    public:
+        SystolicTranspose(DistributedMatrix<T>& A, int64_t off=0, int tag=5558)
+            : SystolicMatrixAlgorithm<T>(A, tag)
+            , off(off)
+        {
+            MADNESS_ASSERT(A.rowdim() >= off+A.coldim());
+        }
+
+        void kernel(int i, int j, T* rowi, T* rowj) {
+            std::swap(rowi[off+j], rowj[off+i]);
+        }
+
+        /// One sweep visits every pair once
+        bool converged(const TaskThreadEnv& env) const {return true;}
+    };
+
+
+    /// Computes \c c=x*y for rows \c [x_i,y_i,c_i] of an (n,n+2m) matrix
+
+    /// The diagonal contribution \c c_i=x_ii*y_i must be present on entry.
+    template <typename T>
+    class SystolicMultiply : public SystolicMatrixAlgorithm<T> {
+        const int64_t n, m;
+
+    public:
+        SystolicMultiply(DistributedMatrix<T>& A, int tag=5559)
+            : SystolicMatrixAlgorithm<T>(A, tag)
+            , n(A.coldim())
+            , m((A.rowdim()-A.coldim())/2)
+        {
+            MADNESS_ASSERT(A.rowdim() == n+2*m);
+        }
+
+        void kernel(int i, int j, T* MADNESS_RESTRICT rowi, T* MADNESS_RESTRICT rowj) {
+            const T xij = rowi[j], xji = rowj[i];
+            const T* MADNESS_RESTRICT yi = rowi + n;
+            const T* MADNESS_RESTRICT yj = rowj + n;
+            T* MADNESS_RESTRICT ci = rowi + n + m;
+            T* MADNESS_RESTRICT cj = rowj + n + m;
+            for (int64_t k=0; k<m; ++k) {
+                ci[k] += xij*yj[k];
+                cj[k] += xji*yi[k];
+            }
+        }
+
+        /// One sweep visits every pair once
+        bool converged(const TaskThreadEnv& env) const {return true;}
+    };
+
+
+    namespace detail {
+
+        /// Returns the transpose of a column-distributed square matrix; collective
+        template <typename T>
+        DistributedMatrix<T> systolic_transpose(const DistributedMatrix<T>& A) {
+            MADNESS_CHECK(A.is_column_distributed() && A.coldim() == A.rowdim());
+            DistributedMatrix<T> B = copy(A);
+            B.get_world().taskq.add(new SystolicTranspose<T>(B));
+            B.get_world().taskq.fence();
+            return B;
+        }
+
+        /// Returns \c x*y for column-distributed \c x(n,n) and \c y(n,m) with the same column tiling; collective
+        template <typename T>
+        DistributedMatrix<T> systolic_multiply(const DistributedMatrix<T>& x, const DistributedMatrix<T>& y) {
+            MADNESS_CHECK(x.coldim() == x.rowdim() && x.coldim() == y.coldim());
+            const int64_t n = x.coldim(), m = y.rowdim();
+
+            DistributedMatrix<T> c(y.distribution());
+            int64_t ilo, ihi;
+            x.local_colrange(ilo, ihi);
+            for (int64_t i=ilo; i<=ihi; ++i) {
+                const T xii = x.data()(i-ilo,i);
+                for (int64_t k=0; k<m; ++k) c.data()(i-ilo,k) = xii*y.data()(i-ilo,k);
+            }
+
+            DistributedMatrix<T> A = concatenate_rows(concatenate_rows(x,y),c);
+            A.get_world().taskq.add(new SystolicMultiply<T>(A));
+            A.get_world().taskq.fence();
+            A.extract_columns(n+m, n+2*m-1, c);
+            return c;
+        }
+
+        /// Scales row \c i of \c A by \c s(i) ; not collective
+        template <typename T>
+        void scale_rows(DistributedMatrix<T>& A, const Tensor<T>& s) {
+            int64_t ilo, ihi;
+            A.local_colrange(ilo, ihi);
+            for (int64_t i=ilo; i<=ihi; ++i) A.data()(i-ilo,_).scale(s(i));
+        }
+    }
+
+
+    /// Diagonalizes a column-distributed real symmetric matrix; collective
+
+    /// The matrix is shifted by its Gershgorin bound to make it positive
+    /// semi-definite and then diagonalized by parallel one-sided Jacobi.
+    /// Eigenvalues are accurate to about \c tol times the norm of \c A .
+    /// @param[in] A The (n,n) matrix
+    /// @param[out] V The eigenvectors are the rows of \c V , distributed as \c A
+    /// @param[out] e The eigenvalues in ascending order (replicated)
+    /// @param[in] tol Threshold for convergence (default is n times the machine precision)
+    template <typename T>
+    void distributed_syev(const DistributedMatrix<T>& A, DistributedMatrix<T>& V, Tensor<T>& e, T tol=0) {
+        MADNESS_CHECK(A.is_column_distributed() && A.coldim() == A.rowdim());
+        World& world = A.get_world();
+        const int64_t n = A.coldim();
+        if (tol <= 0) tol = n*std::numeric_limits<T>::epsilon();
+
+        int64_t ilo, ihi;
+        A.local_colrange(ilo, ihi);
+
+        T shift = 0;
+        for (int64_t i=ilo; i<=ihi; ++i) {
+            T rowsum = 0;
+            for (int64_t k=0; k<n; ++k) rowsum += std::abs(A.data()(i-ilo,k));
+            shift = std::max(shift, rowsum);
+        }
+        world.gop.max(shift);
+
+        V = DistributedMatrix<T>(A.distribution());
+        V.fill_identity();
+        DistributedMatrix<T> B = concatenate_rows(A,V);
+        for (int64_t i=ilo; i<=ihi; ++i) B.data()(i-ilo,i) += shift;
+
+        int nsweep = 0;
+        world.taskq.add(new SystolicJacobiEigensolver<T>(B, tol, nsweep));
+        world.taskq.fence();
+        if (nsweep < 0) MADNESS_EXCEPTION("distributed_syev: Jacobi iteration did not converge", n);
+
+        e = Tensor<T>(n);
+        for (int64_t i=ilo; i<=ihi; ++i) {
+            e(i) = B.data()(i-ilo,Slice(0,n-1)).normf() - shift;
+        }
+        world.gop.sum(e.ptr(), n);
+        B.extract_columns(n, 2*n-1, V);
+    }
+
+
+    /// Solves the generalized eigenproblem \c A*v=B*v*e for column-distributed matrices; collective
+
+    /// \c B is orthonormalized by diagonalization and the transformed
+    /// problem is solved by \c distributed_syev() .  Eigenvectors are
+    /// normalized so that \c V*B*V^T=1 .
+    /// @param[in] A The real symmetric (n,n) matrix
+    /// @param[in] B The positive definite (n,n) matrix, distributed as \c A
+    /// @param[out] V The eigenvectors are the rows of \c V , distributed as \c A
+    /// @param[out] e The eigenvalues in ascending order (replicated)
+    template <typename T>
+    void distributed_sygv(const DistributedMatrix<T>& A, const DistributedMatrix<T>& B,
+                          DistributedMatrix<T>& V, Tensor<T>& e) {
+        MADNESS_CHECK(A.distribution() == B.distribution());
+
+        // Rows of z are the eigenvectors of B scaled so that z*B*z^T=1
+        DistributedMatrix<T> z;
+        Tensor<T> s;
+        distributed_syev(B, z, s);
+        MADNESS_CHECK(s(0L) > 0);
+        for (int64_t i=0; i<s.dim(0); ++i) s(i) = 1/std::sqrt(s(i));
+        detail::scale_rows(z, s);
+
+        // Ap = z*A*z^T
+        DistributedMatrix<T> zA = detail::systolic_multiply(z, A);
+        DistributedMatrix<T> Ap = detail::systolic_multiply(z, detail::systolic_transpose(zA));
+
+        DistributedMatrix<T> U;
+        distributed_syev(Ap, U, e);
+        V = detail::systolic_multiply(U, z);
+    }
+
+
+    /// Returns the symmetric (Lowdin) orthonormalizer \c S^(-1/2) of a column-distributed matrix; collective
+
+    /// @param[in] S The positive definite (n,n) overlap matrix
+    /// @return \c S^(-1/2) , distributed as \c S
+    template <typename T>
+    DistributedMatrix<T> distributed_lowdin(const DistributedMatrix<T>& S) {
+        DistributedMatrix<T> W;
+        Tensor<T> s;
+        distributed_syev(S, W, s);
+        MADNESS_CHECK(s(0L) > 0);
+
+        DistributedMatrix<T> z = copy(W);
+        for (int64_t i=0; i<s.dim(0); ++i) s(i) = 1/std::sqrt(s(i));
+        detail::scale_rows(z, s);
+        return detail::systolic_multiply(detail::systolic_transpose(W), z);
+    }
+
+}
+
+#endif // MADNESS_TENSOR_DISTRIBUTED_EIGEN_H__INCLUDED
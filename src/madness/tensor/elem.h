@@ -34,6 +34,48 @@
 
 #include <madness/madness_config.h>
 #include <madness/world/MADworld.h>
+#include <madness/tensor/tensor_lapack.h>
+#include <madness/tensor/distributed_eigen.h>
+
+namespace madness {
+
+    /// Returns true if an (n,n) eigenproblem should be solved by the distributed Jacobi solver
+
+    /// One-sided Jacobi does several times the work of LAPACK, so it pays
+    /// off only for large matrices spread over enough processes; it also
+    /// avoids every process doing the same O(n^3) work.
+    inline bool use_distributed_eigensolver(World& world, int64_t n) {
+        return world.size() >= 8 && n >= 512;
+    }
+
+    /** \brief  Diagonalize a replicated real symmetric matrix using all processes
+
+    The eigenvectors are the columns of \c V and the eigenvalues are in
+    ascending order, as for \c syev() .  All processes receive the same
+    result.
+    */
+    template <typename T>
+    void syevp(World& world, const Tensor<T>& a, Tensor<T>& V, Tensor<T>& e) {
+        static_assert(!TensorTypeData<T>::iscomplex, "syevp requires a real matrix");
+        TENSOR_ASSERT(a.ndim() == 2, "syevp requires a matrix",a.ndim(),&a);
+        TENSOR_ASSERT(a.dim(0) == a.dim(1), "syevp requires square matrix",0,&a);
+        const int64_t n = a.dim(0);
+        if (use_distributed_eigensolver(world, n)) {
+            DistributedMatrix<T> A = column_distributed_matrix<T>(world, n, n);
+            A.copy_from_replicated(a);
+            DistributedMatrix<T> dV;
+            distributed_syev(A, dV, e);
+            V = Tensor<T>(n,n);
+            dV.copy_to_replicated(V);
+            V = transpose(V);
+        }
+        else {
+            syev(a, V, e);
+            world.gop.broadcast_serializable(V,0);
+            world.gop.broadcast_serializable(e,0);
+        }
+    }
+}
 
 #ifdef MADNESS_HAS_ELEMENTAL_EMBEDDED
 
@@ -516,6 +558,21 @@ namespace madness {
     void sygvp(World& world,
                const Tensor<T>& a, const Tensor<T>& B, int itype,
                Tensor<T>& V, Tensor< typename Tensor<T>::scalar_type >& e) {
+        if constexpr (!TensorTypeData<T>::iscomplex) {
+            const int64_t n = a.dim(0);
+            if (itype == 1 && use_distributed_eigensolver(world, n)) {
+                DistributedMatrix<T> dA = column_distributed_matrix<T>(world, n, n);
+                DistributedMatrix<T> dB = column_distributed_matrix<T>(world, n, n);
+                dA.copy_from_replicated(a);
+                dB.copy_from_replicated(B);
+                DistributedMatrix<T> dV;
+                distributed_sygv(dA, dB, dV, e);
+                V = Tensor<T>(n,n);
+                dV.copy_to_replicated(V);
+                V = transpose(V);
+                return;
+            }
+        }
         sygv(a, B, itype, V, e);
 	world.gop.broadcast_serializable(V,0);
 	world.gop.broadcast_serializable(e,0);
@@ -134,10 +134,12 @@ namespace madness {
 	struct TensorArgs {
 		double thresh;
 		TensorType tt;
-        TensorArgs() : thresh(-1.0), tt(TT_NONE) {}
-		TensorArgs(const double& thresh1, const TensorType& tt1)
+		bool randomized;	///< use randomized SVDs for low-rank decompositions
+        TensorArgs() : thresh(-1.0), tt(TT_NONE), randomized(false) {}
+		TensorArgs(const double& thresh1, const TensorType& tt1, const bool randomized1=false)
 			: thresh(thresh1)
-			, tt(tt1) {
+			, tt(tt1)
+			, randomized(randomized1) {
 		}
 		static std::string what_am_i(const TensorType& tt) {
 			if (tt==TT_2D) return "TT_2D";
@@ -148,7 +150,7 @@ namespace madness {
 		template <typename Archive>
 		void serialize(const Archive& ar) {
 		    int i=int(tt);
-		    ar & thresh & i;
+		    ar & thresh & i & randomized;
 		    tt=TensorType(i);
 		}
 	};
@@ -409,14 +411,14 @@ namespace madness {
 						dims[2*i]=k/2;
 						dims[2*i+1]=2;
 					}
-					TensorTrain<T> tt(rhs,targs.thresh*facReduce(),dims);
+					TensorTrain<T> tt(rhs,targs.thresh*facReduce(),dims,targs.randomized);
 					// fuse sum and wavelet coeffs back together
 					for (int i=0; i<rhs.ndim(); ++i) tt.fusedim(i);
 					// fuse dimensions into particles 1 and 2
 					tt.two_mode_representation(U,VT,s);
 
 				} else {
-					TensorTrain<T> tt(rhs,targs.thresh*facReduce());
+					TensorTrain<T> tt(rhs,targs.thresh*facReduce(),targs.randomized);
 					tt.two_mode_representation(U,VT,s);
 				}
 
@@ -44,6 +44,11 @@ using std::endl;
 using std::min;
 using std::max;
 
+#include <exception>
+#include <mutex>
+#include <madness/world/thread.h>
+#include <madness/world/worldinit.h>
+
 /// \file lapack.cc
 /// \brief Partial interface from Tensor to LAPACK
 
@@ -966,6 +971,205 @@ namespace madness {
     }
 
 
+    namespace detail {
+
+        /// Per-thread LAPACK workspace that is reused by the batched routines
+
+        /// Grows as needed and is never shrunk.  Different \c slot values
+        /// give independent buffers.
+        template <typename T, int slot>
+        Tensor<T>& lapack_workspace(long n) {
+            thread_local Tensor<T> work;
+            if (work.size() < n) work = Tensor<T>(n);
+            return work;
+        }
+
+        /// Pool task running every nchunk-th element of a batch
+        template <typename opT>
+        class LapackBatchTask : public madness::PoolTaskInterface {
+            const opT& op;
+            long first, n, nchunk;
+            madness::AtomicInt& ndone;
+            std::exception_ptr& error;
+            std::mutex& error_mutex;
+
+        public:
+            LapackBatchTask(const opT& op, long first, long n, long nchunk,
+                            madness::AtomicInt& ndone, std::exception_ptr& error,
+                            std::mutex& error_mutex)
+                : op(op), first(first), n(n), nchunk(nchunk), ndone(ndone)
+                , error(error), error_mutex(error_mutex) {}
+
+            void run(const madness::TaskThreadEnv& env) {
+                try {
+                    for (long i=first; i<n; i+=nchunk) op(i);
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error) error = std::current_exception();
+                }
+                ndone++;
+            }
+        };
+
+        /// Calls op(i) for each element of a batch of size n
+
+        /// If the MADNESS runtime is up the batch is run in parallel over
+        /// the ThreadPool, and the caller works on it while it waits.
+        /// Otherwise it is run serially.  The first exception is rethrown.
+        template <typename opT>
+        void lapack_batch(long n, const opT& op) {
+            if (n < 2 || !madness::initialized()) {
+                for (long i=0; i<n; ++i) op(i);
+                return;
+            }
+
+            const long nchunk = std::min<long>(n, 4*(madness::ThreadPool::size()+1));
+            madness::AtomicInt ndone;
+            ndone = 0;
+            std::exception_ptr error;
+            std::mutex error_mutex;
+            for (long c=0; c<nchunk; ++c) {
+                madness::ThreadPool::add(new LapackBatchTask<opT>(op, c, n, nchunk,
+                                                                  ndone, error, error_mutex));
+            }
+            madness::ThreadPool::await([&ndone, nchunk]() {return ndone == nchunk;});
+            if (error) std::rethrow_exception(error);
+        }
+
+    }
+
+    /** \brief  Singular value decompositions of a batch of matrices.
+
+    Same results as calling \c svd for each matrix, but the LAPACK
+    workspace and the copy of each input are per-thread buffers that are
+    reused throughout the batch.  The batch runs in parallel over the
+    ThreadPool if the MADNESS runtime is up.
+    */
+    template <typename T>
+    void svd(const std::vector< Tensor<T> >& a, std::vector< Tensor<T> >& U,
+             std::vector< Tensor< typename Tensor<T>::scalar_type > >& s,
+             std::vector< Tensor<T> >& VT) {
+        const long nbatch = a.size();
+        U.resize(nbatch);
+        s.resize(nbatch);
+        VT.resize(nbatch);
+        auto op = [&](long i) {
+            TENSOR_ASSERT(a[i].ndim() == 2, "svd requires matrix",a[i].ndim(),&a[i]);
+            integer m = a[i].dim(0), n = a[i].dim(1), rmax = min<integer>(m,n);
+            integer lwork = max<integer>(3*min(m,n)+max(m,n),5*min(m,n)-4)*32;
+            integer info;
+            Tensor<T>& work = detail::lapack_workspace<T,0>(lwork);
+            Tensor<T>& A = detail::lapack_workspace<T,1>(m*n);
+            if (a[i].iscontiguous()) {
+                std::copy(a[i].ptr(), a[i].ptr()+m*n, A.ptr());
+            }
+            else {
+                Tensor<T> ai = copy(a[i]);
+                std::copy(ai.ptr(), ai.ptr()+m*n, A.ptr());
+            }
+
+            s[i] = Tensor< typename Tensor<T>::scalar_type >(rmax);
+            U[i] = Tensor<T>(m,rmax);
+            VT[i] = Tensor<T>(rmax,n);
+            dgesvd_("S","S", &n, &m, A.ptr(), &n, s[i].ptr(),
+                    VT[i].ptr(), &n, U[i].ptr(), &rmax, work.ptr(), &lwork,
+                    &info, (char_len) 1, (char_len) 1);
+            mask_info(info);
+            TENSOR_ASSERT(info == 0, "svd: Lapack failed", info, &a[i]);
+        };
+        detail::lapack_batch(nbatch, op);
+    }
+
+    /** \brief  Symmetric or Hermitian eigenvalue problems of a batch of matrices.
+
+    Same results as calling \c syev for each matrix, with the workspace
+    reused and the batch run in parallel as for the batched \c svd.
+    */
+    template <typename T>
+    void syev(const std::vector< Tensor<T> >& A, std::vector< Tensor<T> >& V,
+              std::vector< Tensor< typename Tensor<T>::scalar_type > >& e) {
+        const long nbatch = A.size();
+        V.resize(nbatch);
+        e.resize(nbatch);
+        auto op = [&](long i) {
+            TENSOR_ASSERT(A[i].ndim() == 2, "syev requires a matrix",A[i].ndim(),&A[i]);
+            TENSOR_ASSERT(A[i].dim(0) == A[i].dim(1), "syev requires square matrix",0,&A[i]);
+            integer n = A[i].dim(0);
+            integer lwork = max(max((integer) 1,(integer) (3*n-1)),(integer) (34*n));
+            integer info;
+            Tensor<T>& work = detail::lapack_workspace<T,0>(lwork);
+            V[i] = transpose(A[i]);		// For Hermitian case
+            e[i] = Tensor<typename Tensor<T>::scalar_type>(n);
+            dsyev_("V", "U", &n, V[i].ptr(), &n, e[i].ptr(), work.ptr(), &lwork, &info,
+                   (char_len) 1, (char_len) 1);
+            mask_info(info);
+            TENSOR_ASSERT(info == 0, "(s/d)syev/(c/z)heev failed", info, &A[i]);
+            V[i] = transpose(V[i]);
+        };
+        detail::lapack_batch(nbatch, op);
+    }
+
+    /// Cholesky factorizations of a batch of matrices, in place and in parallel
+    template <typename T>
+    void cholesky(std::vector< Tensor<T> >& A) {
+        detail::lapack_batch(A.size(), [&A](long i) {cholesky(A[i]);});
+    }
+
+    /// Rank-revealing Cholesky factorizations of a batch of matrices
+
+    /// Same results as calling \c rr_cholesky for each matrix, with the
+    /// workspace reused and the batch run in parallel.
+    template <typename T>
+    void rr_cholesky(std::vector< Tensor<T> >& A, typename Tensor<T>::scalar_type tol,
+                     std::vector< Tensor<integer> >& piv, std::vector<int>& rank) {
+        const long nbatch = A.size();
+        piv.resize(nbatch);
+        rank.resize(nbatch);
+        auto op = [&](long i) {
+            integer n = A[i].dim(0);
+            integer info;
+            piv[i] = Tensor<integer>(n);
+            Tensor<T>& work = detail::lapack_workspace<T,0>(2*n);
+
+            integer irank = static_cast<integer>(rank[i]);
+            pstrf_("L", &n, A[i].ptr(), &n, piv[i].ptr(), &irank, &tol, work.ptr(), &info);
+            rank[i] = static_cast<int>(irank);
+            mask_info(info);
+            TENSOR_ASSERT(info >= 0, "rr_cholesky: Lapack failed", info, &A[i]);
+
+            for (int k=0; k<n; ++k)
+                for (int j=0; j<k; ++j)
+                    A[i](k,j) = 0.0;
+            for (int k=0; k<n; ++k) piv[i][k]--;
+        };
+        detail::lapack_batch(nbatch, op);
+    }
+
+    /// QR decompositions of a batch of matrices
+
+    /// Same results as calling \c qr for each matrix, with the workspace
+    /// reused and the batch run in parallel.
+    template<typename T>
+    void qr(std::vector< Tensor<T> >& A, std::vector< Tensor<T> >& R) {
+        const long nbatch = A.size();
+        R.resize(nbatch);
+        auto op = [&](long i) {
+            TENSOR_ASSERT(A[i].ndim() == 2, "qr requires a matrix",A[i].ndim(),&A[i]);
+            integer m=A[i].dim(0);
+            integer n=A[i].dim(1);
+            Tensor<T>& tau = detail::lapack_workspace<T,1>(std::min(n,m));
+            Tensor<T>& work = detail::lapack_workspace<T,0>(2*n+(n+1)*64);
+            R[i]=Tensor<T>(std::min(m,n),n);
+
+            A[i]=transpose(A[i]);
+            lq_result(A[i],R[i],tau,work,true);
+            A[i]=transpose(A[i]);
+        };
+        detail::lapack_batch(nbatch, op);
+    }
+
+
 //     template <typename T>
 //     void triangular_solve(const Tensor<T>& L, Tensor<T>& B, const char* side, const char* transa) {
 //         integer n = L.dim(0);  // ????
@@ -1324,6 +1528,20 @@ namespace madness {
     template
     void qr(Tensor<double>& A, Tensor<double>& R);
 
+    template
+    void svd(const std::vector< Tensor<double> >& a, std::vector< Tensor<double> >& U,
+             std::vector< Tensor<double> >& s, std::vector< Tensor<double> >& VT);
+    template
+    void syev(const std::vector< Tensor<double> >& A, std::vector< Tensor<double> >& V,
+              std::vector< Tensor<double> >& e);
+    template
+    void cholesky(std::vector< Tensor<double> >& A);
+    template
+    void rr_cholesky(std::vector< Tensor<double> >& A, double tol,
+                     std::vector< Tensor<integer> >& piv, std::vector<int>& rank);
+    template
+    void qr(std::vector< Tensor<double> >& A, std::vector< Tensor<double> >& R);
+
     template
     void lq(Tensor<double>& A, Tensor<double>& L);
 
@@ -1373,6 +1591,18 @@ namespace madness {
     template
     void rr_cholesky(Tensor<double_complex>& A, typename Tensor<double_complex>::scalar_type tol, Tensor<integer>& piv, int& rank);
 
+    template
+    void svd(const std::vector< Tensor<double_complex> >& a, std::vector< Tensor<double_complex> >& U,
+             std::vector< Tensor<double> >& s, std::vector< Tensor<double_complex> >& VT);
+    template
+    void syev(const std::vector< Tensor<double_complex> >& A, std::vector< Tensor<double_complex> >& V,
+              std::vector< Tensor<double> >& e);
+    template
+    void cholesky(std::vector< Tensor<double_complex> >& A);
+    template
+    void rr_cholesky(std::vector< Tensor<double_complex> >& A, double tol,
+                     std::vector< Tensor<integer> >& piv, std::vector<int>& rank);
+
 //     template
 //     void triangular_solve(const Tensor<double_complex>& L, Tensor<double_complex>& B,
 //                           const char* side, const char* transa);
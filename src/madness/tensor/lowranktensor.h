@@ -150,7 +150,7 @@ public:
             } else if ((type==TT_2D) or (type==TT_TENSORTRAIN)) {
 
                 // construct tensortrain first, convert into SVD format afterwards
-                std::shared_ptr<TensorTrain<T> > tt(new TensorTrain<T>(rhs,targs.thresh*facReduce()));
+                std::shared_ptr<TensorTrain<T> > tt(new TensorTrain<T>(rhs,targs.thresh*facReduce(),targs.randomized));
 
                 if (type==TT_2D) {
                     Tensor<T> U,VT;
@@ -1381,33 +1381,17 @@ protected:
 
 
 	    // set up overlap M; include X+
-	    tensorT M(rank1,rank2);
-	    for (unsigned int i=0; i<rank1; i++) {
-	    	for (unsigned int j=0; j<rank2; j++) {
-	    		for (unsigned int r=0; r<rank; r++) {
-		    		M(i,j)+=U1(r,i)*sqrt_e1(i)*weights(r)*U2(r,j) * sqrt_e2(j);
-//			    		M(i,j)+=U1(r,i)*weights(r)*U2(r,j);
-	    		}
-	    	}
-	    }
+	    // as a matrix product instead of an element-wise triple loop, as in ortho5
+	    tensorT UU1=copy(U1);
+	    for (unsigned int r=0; r<rank; r++) UU1(r,_)*=weights(r);
+	    tensorT M=inner(UU1,U2,0,0);
+	    tensorT ee=outer(sqrt_e1,sqrt_e2);
+	    M.emul(ee);
 
 
 	    // include X-
-    	for (unsigned int r=0; r<rank1; r++) {
-    		double fac=1.0/sqrt_e1(r);
-    		for (unsigned int t=0; t<rank; t++) {
-	    		U1(t,r)*=fac;
-//	    		if (sqrt_e1(r)<thresh) throw;
-    		}
-    	}
-
-	   	for (unsigned int r=0; r<rank2; r++) {
-    		double fac=1.0/sqrt_e2(r);
-    		for (unsigned int t=0; t<rank; t++) {
-	    		U2(t,r)*=fac;
-//	    		if (sqrt_e2(r)<thresh) throw;
-	    	}
-	    }													// 0.2 / 0.6
+    	for (unsigned int r=0; r<rank1; r++) U1(_,r)*=1.0/sqrt_e1(r);
+	   	for (unsigned int r=0; r<rank2; r++) U2(_,r)*=1.0/sqrt_e2(r);	// 0.2 / 0.6
 #ifdef BENCH
 		double cpu5=wall_time();
 		SRConf<T>::time(5)+=cpu5-cpu4;
@@ -0,0 +1,313 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_TENSOR_TENSOR_EXPR_H__INCLUDED
+#define MADNESS_TENSOR_TENSOR_EXPR_H__INCLUDED
+
+/// \file tensor_expr.h
+/// \brief Lazily evaluated element-wise tensor expressions
+
+/// The arithmetic operators of Tensor allocate and fill a new tensor for
+/// every operation, so that an expression like \c (a-b)*x+c makes three
+/// temporaries and streams memory three times.  Wrapping one operand in
+/// lazy() instead builds an expression object that is evaluated in a
+/// single loop, without temporaries, when it is assigned to a tensor.
+/// \code
+/// Tensor<double> r = (lazy(a) - b)*x + c;     // one new tensor, one pass
+/// assign(s(s0), lazy(a) + b);                 // into existing storage
+/// gaxpy(s, 1.0, emul(lazy(a), b), 2.0);       // s = s + 2*a.*b
+/// double err = normf(lazy(a) - b);            // no temporary at all
+/// \endcode
+/// The operands must conform.  An expression holds shallow copies of its
+/// tensors, so it stays valid while they are alive, but it reads their
+/// current values only when it is evaluated.  Non-contiguous operands are
+/// copied once when the expression is made.
+
+#include <cmath>
+#include <complex>
+#include <type_traits>
+#include <madness/tensor/tensor.h>
+
+namespace madness {
+
+    /// Base of all tensor expressions; \c exprT is the derived class
+    template <typename exprT>
+    class TensorExpr {
+    public:
+        const exprT& derived() const {return static_cast<const exprT&>(*this);}
+
+        /// Evaluates the expression into a new tensor
+        template <typename T>
+        operator Tensor<T>() const {
+            Tensor<T> result(derived().shape().ndim(), derived().shape().dims(), false);
+            T* MADNESS_RESTRICT p = result.ptr();
+            const exprT& e = derived();
+            const long n = result.size();
+            for (long i=0; i<n; ++i) p[i] = e[i];
+            return result;
+        }
+    };
+
+    /// A tensor operand of an expression
+    template <typename T>
+    class TensorExprLeaf : public TensorExpr< TensorExprLeaf<T> > {
+        Tensor<T> t;            ///< Shallow copy of a contiguous tensor
+        const T* p;             ///< Data of t
+
+    public:
+        typedef T resultT;
+
+        explicit TensorExprLeaf(const Tensor<T>& t)
+            : t(t.iscontiguous() ? t : copy(t)), p(this->t.ptr()) {}
+
+        TensorExprLeaf(const TensorExprLeaf<T>& other) : t(other.t), p(t.ptr()) {}
+
+        resultT operator[](long i) const {return p[i];}
+
+        const BaseTensor& shape() const {return t;}
+    };
+
+    /// Element-wise operation of two expressions
+    template <typename leftT, typename rightT, typename opT>
+    class TensorExprBinary : public TensorExpr< TensorExprBinary<leftT,rightT,opT> > {
+        const leftT left;
+        const rightT right;
+
+    public:
+        typedef decltype(opT()(std::declval<typename leftT::resultT>(),
+                               std::declval<typename rightT::resultT>())) resultT;
+
+        TensorExprBinary(const leftT& left, const rightT& right) : left(left), right(right) {
+            TENSOR_ASSERT(left.shape().conforms(&right.shape()), "tensor expression: operands do not conform",
+                          0, &right.shape());
+        }
+
+        resultT operator[](long i) const {return opT()(left[i], right[i]);}
+
+        const BaseTensor& shape() const {return left.shape();}
+    };
+
+    /// Element-wise operation of an expression and a scalar
+    template <typename exprT, typename Q, typename opT>
+    class TensorExprScalar : public TensorExpr< TensorExprScalar<exprT,Q,opT> > {
+        const exprT expr;
+        const Q x;
+
+    public:
+        typedef decltype(opT()(std::declval<typename exprT::resultT>(), std::declval<Q>())) resultT;
+
+        TensorExprScalar(const exprT& expr, const Q& x) : expr(expr), x(x) {}
+
+        resultT operator[](long i) const {return opT()(expr[i], x);}
+
+        const BaseTensor& shape() const {return expr.shape();}
+    };
+
+    namespace detail {
+        struct TensorExprAdd {
+            template <typename A, typename B>
+            auto operator()(const A& a, const B& b) const -> decltype(a+b) {return a+b;}
+        };
+
+        struct TensorExprSub {
+            template <typename A, typename B>
+            auto operator()(const A& a, const B& b) const -> decltype(a-b) {return a-b;}
+        };
+
+        struct TensorExprMul {
+            template <typename A, typename B>
+            auto operator()(const A& a, const B& b) const -> decltype(a*b) {return a*b;}
+        };
+
+        struct TensorExprDiv {
+            template <typename A, typename B>
+            auto operator()(const A& a, const B& b) const -> decltype(a/b) {return a/b;}
+        };
+
+        /// Wraps tensors in a leaf and passes expressions through
+        template <typename T>
+        TensorExprLeaf<T> tensor_expr_operand(const Tensor<T>& t) {return TensorExprLeaf<T>(t);}
+
+        template <typename exprT>
+        const exprT& tensor_expr_operand(const TensorExpr<exprT>& e) {return e.derived();}
+
+        template <typename A>
+        using tensor_expr_operand_t = typename std::decay<decltype(tensor_expr_operand(std::declval<const A&>()))>::type;
+
+        /// True for tensors and expressions
+        template <typename A>
+        struct is_tensor_expr_operand {
+            template <typename T> static std::true_type test(const Tensor<T>*);
+            template <typename E> static std::true_type test(const TensorExpr<E>*);
+            static std::false_type test(...);
+            static const bool value = decltype(test(std::declval<const A*>()))::value;
+        };
+
+        /// True for expressions
+        template <typename A>
+        struct is_tensor_expr {
+            template <typename E> static std::true_type test(const TensorExpr<E>*);
+            static std::false_type test(...);
+            static const bool value = decltype(test(std::declval<const A*>()))::value;
+        };
+
+        /// Result of a binary operation if at least one operand is an expression
+        template <typename A, typename B, typename opT>
+        using tensor_expr_binary_t = typename std::enable_if<
+            is_tensor_expr_operand<A>::value && is_tensor_expr_operand<B>::value &&
+            (is_tensor_expr<A>::value || is_tensor_expr<B>::value),
+            TensorExprBinary<tensor_expr_operand_t<A>, tensor_expr_operand_t<B>, opT> >::type;
+    }
+
+    /// Starts a lazily evaluated expression from a tensor
+    template <typename T>
+    TensorExprLeaf<T> lazy(const Tensor<T>& t) {
+        return TensorExprLeaf<T>(t);
+    }
+
+    /// Element-wise sum; at least one operand must be an expression
+    template <typename A, typename B>
+    detail::tensor_expr_binary_t<A,B,detail::TensorExprAdd>
+    operator+(const A& a, const B& b) {
+        return {detail::tensor_expr_operand(a), detail::tensor_expr_operand(b)};
+    }
+
+    /// Element-wise difference; at least one operand must be an expression
+    template <typename A, typename B>
+    detail::tensor_expr_binary_t<A,B,detail::TensorExprSub>
+    operator-(const A& a, const B& b) {
+        return {detail::tensor_expr_operand(a), detail::tensor_expr_operand(b)};
+    }
+
+    /// Element-wise product; at least one operand must be an expression
+    template <typename A, typename B>
+    detail::tensor_expr_binary_t<A,B,detail::TensorExprMul>
+    emul(const A& a, const B& b) {
+        return {detail::tensor_expr_operand(a), detail::tensor_expr_operand(b)};
+    }
+
+    /// Multiplication of an expression by a scalar
+    template <typename exprT, typename Q>
+    typename IsSupported<TensorTypeData<Q>, TensorExprScalar<exprT,Q,detail::TensorExprMul> >::type
+    operator*(const TensorExpr<exprT>& e, const Q& x) {
+        return {e.derived(), x};
+    }
+
+    /// Multiplication of an expression by a scalar
+    template <typename exprT, typename Q>
+    typename IsSupported<TensorTypeData<Q>, TensorExprScalar<exprT,Q,detail::TensorExprMul> >::type
+    operator*(const Q& x, const TensorExpr<exprT>& e) {
+        return {e.derived(), x};
+    }
+
+    /// Division of an expression by a scalar
+    template <typename exprT, typename Q>
+    typename IsSupported<TensorTypeData<Q>, TensorExprScalar<exprT,Q,detail::TensorExprDiv> >::type
+    operator/(const TensorExpr<exprT>& e, const Q& x) {
+        return {e.derived(), x};
+    }
+
+    /// Negation of an expression
+    template <typename exprT>
+    TensorExprScalar<exprT,typename exprT::resultT,detail::TensorExprMul>
+    operator-(const TensorExpr<exprT>& e) {
+        return {e.derived(), typename exprT::resultT(-1)};
+    }
+
+    /// Evaluates an expression into a new tensor of its element type
+    template <typename exprT>
+    Tensor<typename exprT::resultT> evaluate(const TensorExpr<exprT>& e) {
+        return e;
+    }
+
+    /// Evaluates an expression into existing storage, which may be a slice
+    template <typename T, typename exprT>
+    void assign(Tensor<T> t, const TensorExpr<exprT>& expr) {
+        const exprT& e = expr.derived();
+        TENSOR_ASSERT(e.shape().conforms(&t), "assign: expression does not conform", 0, &t);
+        if (t.iscontiguous()) {
+            T* MADNESS_RESTRICT p = t.ptr();
+            const long n = t.size();
+            for (long i=0; i<n; ++i) p[i] = e[i];
+        }
+        else {
+            // The unoptimized iterator visits the elements in index order
+            long i = 0;
+            UNARY_UNOPTIMIZED_ITERATOR(T, t, *_p0 = e[i++]);
+        }
+    }
+
+    /// Inplace generalized saxpy with an expression ... t = t*alpha + expr*beta
+    template <typename T, typename exprT>
+    void gaxpy(Tensor<T> t, T alpha, const TensorExpr<exprT>& expr, T beta) {
+        const exprT& e = expr.derived();
+        TENSOR_ASSERT(e.shape().conforms(&t), "gaxpy: expression does not conform", 0, &t);
+        if (t.iscontiguous()) {
+            T* MADNESS_RESTRICT p = t.ptr();
+            const long n = t.size();
+            if (alpha == T(1.0)) {
+                for (long i=0; i<n; ++i) p[i] += e[i]*beta;
+            }
+            else {
+                for (long i=0; i<n; ++i) p[i] = p[i]*alpha + e[i]*beta;
+            }
+        }
+        else {
+            long i = 0;
+            UNARY_UNOPTIMIZED_ITERATOR(T, t, *_p0 = (*_p0)*alpha + e[i++]*beta);
+        }
+    }
+
+    /// Returns the sum of the elements of an expression
+    template <typename exprT>
+    typename exprT::resultT sum(const TensorExpr<exprT>& expr) {
+        const exprT& e = expr.derived();
+        typename exprT::resultT result(0);
+        const long n = e.shape().size();
+        for (long i=0; i<n; ++i) result += e[i];
+        return result;
+    }
+
+    /// Returns the Frobenius norm of an expression
+    template <typename exprT>
+    typename TensorTypeData<typename exprT::resultT>::float_scalar_type
+    normf(const TensorExpr<exprT>& expr) {
+        typedef typename TensorTypeData<typename exprT::resultT>::float_scalar_type resultT;
+        const exprT& e = expr.derived();
+        resultT result = 0;
+        const long n = e.shape().size();
+        for (long i=0; i<n; ++i) result += ::madness::detail::mynorm(e[i]);
+        return (resultT) std::sqrt(result);
+    }
+
+}
+
+#endif // MADNESS_TENSOR_TENSOR_EXPR_H__INCLUDED
@@ -165,6 +165,39 @@ namespace madness {
     void orgqr(Tensor<T>& A, const Tensor<T>& tau);
 
 
+    /// \name Batched factorizations
+    /// For many small matrices: each overload gives the same results as
+    /// the single-matrix routine applied to every element, but reuses
+    /// per-thread LAPACK workspace and runs the batch in parallel over the
+    /// ThreadPool once the MADNESS runtime is initialized.
+    /// @{
+
+    /// \ingroup linalg
+    template <typename T>
+    void svd(const std::vector< Tensor<T> >& a, std::vector< Tensor<T> >& U,
+             std::vector< Tensor< typename Tensor<T>::scalar_type > >& s,
+             std::vector< Tensor<T> >& VT);
+
+    /// \ingroup linalg
+    template <typename T>
+    void syev(const std::vector< Tensor<T> >& A, std::vector< Tensor<T> >& V,
+              std::vector< Tensor< typename Tensor<T>::scalar_type > >& e);
+
+    /// \ingroup linalg
+    template <typename T>
+    void cholesky(std::vector< Tensor<T> >& A);
+
+    /// \ingroup linalg
+    template <typename T>
+    void rr_cholesky(std::vector< Tensor<T> >& A, typename Tensor<T>::scalar_type tol,
+                     std::vector< Tensor<integer> >& piv, std::vector<int>& rank);
+
+    /// \ingroup linalg
+    template<typename T>
+    void qr(std::vector< Tensor<T> >& A, std::vector< Tensor<T> >& R);
+
+    /// @}
+
     /// Dunno
     
 //     /// \ingroup linalg
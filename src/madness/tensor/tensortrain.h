@@ -107,6 +107,77 @@ namespace madness {
     }
 
 
+    /// truncated SVD A = U s VT using a randomized range finder
+
+    /// The range of A is sampled by random vectors, doubling their number until
+    /// the part of A outside of the sampled subspace Q is below thresh. Only the
+    /// small projected matrix Q^H A is then decomposed deterministically, at a
+    /// cost of O(nml) instead of O(nm min(n,m)).
+    /// @param[in]  A       the input matrix (n,m), not modified
+    /// @param[out] U       left singular vectors (n,r)
+    /// @param[out] s       singular values (r)
+    /// @param[out] VT      right singular vectors (r,m)
+    /// @param[in]  thresh  truncation threshold in the Frobenius norm
+    /// @return     false if sampling does not pay off, leaving the output untouched
+    template<typename T>
+    bool randomized_svd(const Tensor<T>& A, Tensor<T>& U,
+            Tensor< typename Tensor<T>::scalar_type >& s, Tensor<T>& VT,
+            const double thresh) {
+
+        typedef typename Tensor<T>::scalar_type scalar_type;
+        MADNESS_ASSERT(A.ndim()==2);    // must be a matrix
+        const long n=A.dim(0);
+        const long m=A.dim(1);
+        const long rmax=std::min(n,m);
+
+        // the residual is computed by cancellation, which limits its precision
+        const double norm2=std::pow(A.normf(),2);
+        if (thresh*thresh<1.e-12*norm2) return false;
+
+        // thin svd; on return a holds VT in its first rows
+        auto thin_svd=[](Tensor<T>& a, Tensor<T>& u, Tensor<scalar_type>& sv) {
+            const long mm=a.dim(0), nn=a.dim(1), rr=std::min(mm,nn);
+            long lwork=std::max(3*rr+std::max(mm,nn),5*rr)*32;
+            Tensor<T> work(lwork), dummy;
+            u=Tensor<T>(mm,rr);
+            sv=Tensor<scalar_type>(rr);
+            svd_result(a,u,sv,dummy,work);
+        };
+
+        for (long l=std::min(8l,rmax); 2*l<=rmax; l*=2) {
+            Tensor<T> omega(m,l);
+            omega.fillrandom();
+            omega-=0.5;
+
+            // orthonormal basis Q of the sampled range
+            Tensor<T> Q, Y=inner(A,omega);
+            Tensor<scalar_type> sy;
+            thin_svd(Y,Q,sy);
+
+            Tensor<T> B=inner(conj(Q),A,0,0);
+            const double resid2=norm2-std::pow(B.normf(),2);
+            if (resid2>0.5*thresh*thresh) continue;
+
+            Tensor<T> u;
+            Tensor<scalar_type> sb;
+            thin_svd(B,u,sb);
+            const long r=SRConf<T>::max_sigma(std::sqrt(thresh*thresh-std::max(resid2,0.0)),
+                    sb.size(),sb)+1;
+            if (r>0) {
+                U=inner(Q,u(_,Slice(0,r-1)));
+                VT=copy(B(Slice(0,r-1),_));
+                s=copy(sb(Slice(0,r-1)));
+            } else {
+                U=Tensor<T>(n,0l);
+                VT=Tensor<T>(0l,m);
+                s=Tensor<scalar_type>(0l);
+            }
+            return true;
+        }
+        return false;
+    }
+
+
 
 	/**
 	 * A tensor train is a multi-modal representation of a tensor t
@@ -159,7 +230,8 @@ namespace madness {
 		///
 		/// @param[in]	t	full representation of a tensor
 		/// @param[in]	eps	the accuracy threshold
-		TensorTrain(const Tensor<T>& t, double eps)
+		/// @param[in]	randomized	use randomized SVDs where they pay off
+		TensorTrain(const Tensor<T>& t, double eps, bool randomized=false)
 			: core(), zero_rank(false) {
 
 		    MADNESS_ASSERT(t.size() != 0);
@@ -167,7 +239,7 @@ namespace madness {
 
             std::vector<long> dims(t.ndim());
             for (int d=0; d<t.ndim(); ++d) dims[d]=t.dim(d);
-            decompose(t.flat(),eps,dims);
+            decompose(t.flat(),eps,dims,randomized);
 
 		}
 
@@ -183,12 +255,14 @@ namespace madness {
 		/// @param[in]	t		full representation of a tensor
 		/// @param[in]	eps		the accuracy threshold
 		/// @param[in]	dims	the tt structure
-		TensorTrain(const Tensor<T>& t, double eps, const std::vector<long> dims)
+		/// @param[in]	randomized	use randomized SVDs where they pay off
+		TensorTrain(const Tensor<T>& t, double eps, const std::vector<long> dims,
+				bool randomized=false)
 			: core(), zero_rank(false) {
 
 		    MADNESS_ASSERT(t.size() != 0);
             MADNESS_ASSERT(t.ndim() != 0);
-            decompose(t,eps,dims);
+            decompose(t,eps,dims,randomized);
 		}
 
 		/// ctor for a TensorTrain, set up only the dimensions, no data
@@ -322,8 +396,9 @@ namespace madness {
 		/// @param[in]	t		tensor in full rank
 		/// @param[in]	eps		the precision threshold
 		/// @param[in]	dims	the tt structure
+		/// @param[in]	randomized	use randomized SVDs (see randomized_svd)
 		void decompose(const Tensor<T>& t, double eps,
-				const std::vector<long>& dims) {
+				const std::vector<long>& dims, bool randomized=false) {
 
 			core.resize(dims.size());
 			eps=eps/sqrt(dims.size()-1);	// error is relative
@@ -387,13 +462,23 @@ namespace madness {
 				// c will be destroyed upon return
 				Tensor<T> aa=copy(c);
 #endif
-				// The svd routine assumes lda=a etc. Pass in a flat tensor and reshape
-				// and slice it after processing.
-				u=u.flat();
-				svd_result(c,u,s,dummy,work);
+				// try the randomized range finder first, which is cheap if the
+				// rank is small compared to the matrix dimensions
+				Tensor<T> ur, vtr;
+				Tensor< typename Tensor<T>::scalar_type > sr;
+				const bool sampled=randomized and randomized_svd(c,ur,sr,vtr,eps);
+
+				if (sampled) {
+					r[d]=sr.size();
+				} else {
+					// The svd routine assumes lda=a etc. Pass in a flat tensor and reshape
+					// and slice it after processing.
+					u=u.flat();
+					svd_result(c,u,s,dummy,work);
 
-				// this is rank_right
-				r[d]=SRConf<T>::max_sigma(eps,rmax,s)+1;
+					// this is rank_right
+					r[d]=SRConf<T>::max_sigma(eps,rmax,s)+1;
+				}
 				const long rank=r[d];
 
 				// this is for testing
@@ -416,7 +501,15 @@ namespace madness {
 				//        VT = Tensor<T>(rmax,n);
 
 				// handle rank=0 explicitly
-				if (r[d]) {
+				if (r[d] and sampled) {
+
+					core[d-1]=ur.reshape(r[d-1],k,r[d]);
+					c=vtr;
+					for (int i=0; i<rank; ++i) c(i,_)*=sr(i);
+
+					if (d == dims.size()-1) core[d]=c;
+				}
+				else if (r[d]) {
 
 					// done with this dimension -- slice and deep-copy
 					core[d-1]=madness::copy((u(Slice(0,c.dim(0)*rmax-1)))
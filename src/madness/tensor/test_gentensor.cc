@@ -36,6 +36,7 @@
 #include <madness/tensor/gentensor.h>
 #include <madness/tensor/lowranktensor.h>
 #include <madness/world/print.h>
+#include <madness/world/timers.h>
 
 #if defined USE_GENTENSOR && MADNESS_HAS_GOOGLE_TEST
 
@@ -650,6 +651,41 @@ namespace {
         }
     }
 
+
+    /// compare the randomized decomposition to the deterministic one
+    TEST(LowRankTensorTest, RandomizedDecomposition) {
+        const long n=12;
+        const int ndim=6;
+        const std::vector<long> dim(ndim,n);
+
+        // sum of a few separable Gaussians has low TT ranks
+        Tensor<double> t(dim);
+        for (int a=0; a<4; ++a) {
+            Tensor<double> v(n);
+            for (long i=0; i<n; ++i) v(i)=exp(-std::pow(double(i)/n-0.2*a,2)*(5.0+a));
+            Tensor<double> vv=v;
+            for (int d=1; d<ndim; ++d) vv=outer(vv,v);
+            t+=vv;
+        }
+        t.scale(1.0/t.normf());
+
+        double wall0=wall_time();
+        TensorTrain<double> tt0(t,eps);
+        double wall1=wall_time();
+        TensorTrain<double> tt1(t,eps,true);
+        double wall2=wall_time();
+        LowRankTensor<double> g1(t,TensorArgs(eps,TT_TENSORTRAIN,true));
+
+        const double err0=(tt0.reconstruct()-t).normf();
+        const double err1=(tt1.reconstruct()-t).normf();
+        print("deterministic: error, ranks, time",err0,tt0.ranks(),wall1-wall0);
+        print("randomized:    error, ranks, time",err1,tt1.ranks(),wall2-wall1);
+
+        EXPECT_LT(err0,eps);
+        EXPECT_LT(err1,eps);
+        EXPECT_LT((g1.full_tensor_copy()-t).normf(),eps);
+    }
+
 }
 
 int main(int argc, char** argv) {
@@ -40,9 +40,109 @@
 #include <madness/tensor/tensor_lapack.h>
 #include <iostream>
 #include <madness/madness_config.h>
+#include <madness/world/MADworld.h>
 
 using namespace madness;
 
+/// Compares the batched factorizations with one call per matrix, and times both
+bool test_batched_lapack() {
+    const long nbatch = 4000, n = 8;
+    std::vector< Tensor<double> > a(nbatch), h(nbatch), p(nbatch);
+    for (long i=0; i<nbatch; ++i) {
+        a[i] = Tensor<double>(n,n+2);
+        a[i].fillrandom();
+        h[i] = inner(a[i],a[i],1,1);
+        p[i] = copy(h[i]);
+        for (long j=0; j<n; ++j) p[i](j,j) += 1.0;
+    }
+
+    double err = 0.0;
+    Tensor<double> U, s, VT, V, e, R;
+    std::vector< Tensor<double> > vU, vs, vVT, vV, ve, vR;
+
+    double t0 = wall_time();
+    for (long i=0; i<nbatch; ++i) {
+        svd(a[i],U,s,VT);
+        err = std::max(err, s.normf());     // Just to use the result
+    }
+    double t1 = wall_time();
+    svd(a,vU,vs,vVT);
+    double t2 = wall_time();
+    err = 0.0;
+    for (long i=0; i<nbatch; ++i) {
+        svd(a[i],U,s,VT);
+        Tensor<double> Us = copy(vU[i]);
+        for (long j=0; j<Us.dim(1); ++j) Us(_,j).scale(vs[i](j));
+        err = std::max(err, (s-vs[i]).normf() + (inner(Us,vVT[i])-a[i]).normf());
+    }
+    std::cout << "batched svd:         single " << t1-t0 << "s  batched " << t2-t1 << "s  err " << err << std::endl;
+    bool ok = err < 1e-12;
+
+    t0 = wall_time();
+    for (long i=0; i<nbatch; ++i) syev(h[i],V,e);
+    t1 = wall_time();
+    syev(h,vV,ve);
+    t2 = wall_time();
+    err = 0.0;
+    for (long i=0; i<nbatch; ++i) {
+        syev(h[i],V,e);
+        err = std::max(err, (e-ve[i]).normf());
+    }
+    std::cout << "batched syev:        single " << t1-t0 << "s  batched " << t2-t1 << "s  err " << err << std::endl;
+    ok = ok && err < 1e-12;
+
+    std::vector< Tensor<double> > l(nbatch), vl(nbatch);
+    for (long i=0; i<nbatch; ++i) {
+        l[i] = copy(p[i]);
+        vl[i] = copy(p[i]);
+    }
+    t0 = wall_time();
+    for (long i=0; i<nbatch; ++i) cholesky(l[i]);
+    t1 = wall_time();
+    cholesky(vl);
+    t2 = wall_time();
+    err = 0.0;
+    for (long i=0; i<nbatch; ++i) err = std::max(err, (l[i]-vl[i]).normf());
+    std::cout << "batched cholesky:    single " << t1-t0 << "s  batched " << t2-t1 << "s  err " << err << std::endl;
+    ok = ok && err < 1e-12;
+
+    std::vector< Tensor<integer> > vpiv;
+    std::vector<int> vrank;
+    for (long i=0; i<nbatch; ++i) {
+        l[i] = copy(h[i]);
+        vl[i] = copy(h[i]);
+    }
+    Tensor<integer> piv;
+    t0 = wall_time();
+    for (long i=0; i<nbatch; ++i) {
+        int rank = 0;
+        rr_cholesky(l[i],1e-10,piv,rank);
+    }
+    t1 = wall_time();
+    rr_cholesky(vl,1e-10,vpiv,vrank);
+    t2 = wall_time();
+    err = 0.0;
+    for (long i=0; i<nbatch; ++i) err = std::max(err, (l[i]-vl[i]).normf());
+    std::cout << "batched rr_cholesky: single " << t1-t0 << "s  batched " << t2-t1 << "s  err " << err << std::endl;
+    ok = ok && err < 1e-12;
+
+    for (long i=0; i<nbatch; ++i) {
+        l[i] = copy(a[i]);
+        vl[i] = copy(a[i]);
+    }
+    t0 = wall_time();
+    for (long i=0; i<nbatch; ++i) qr(l[i],R);
+    t1 = wall_time();
+    qr(vl,vR);
+    t2 = wall_time();
+    err = 0.0;
+    for (long i=0; i<nbatch; ++i) err = std::max(err, (inner(vl[i],vR[i])-a[i]).normf());
+    std::cout << "batched qr:          single " << t1-t0 << "s  batched " << t2-t1 << "s  err " << err << std::endl;
+    ok = ok && err < 1e-12;
+
+    return ok;
+}
+
 
 
 int
@@ -58,9 +158,13 @@ main(int argc, char* argv[]) {
 //vama    const int myrank = 0;
 //vama#endif
 
+    initialize(argc, argv);
+
     bool testok = test_tensor_lapack();
+    testok = test_batched_lapack() && testok;
     std::cout << "Test " << (testok ? "passed" : "did not pass") << std::endl;
 
+    finalize();
     return int(!testok);
 }
 
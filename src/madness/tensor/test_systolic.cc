@@ -2,6 +2,7 @@
 #include <utility>
 #include <madness/tensor/tensor.h>
 #include <madness/tensor/systolic.h>
+#include <madness/tensor/distributed_eigen.h>
 
 using namespace madness;
 
@@ -46,6 +47,66 @@ public:
 };
 
 
+double symmetric_element(int64_t i, int64_t j) {
+    return std::sin(double(i+j)) + std::cos(double(i*j)) + ((i==j) ? 0.1*i : 0.0);
+}
+
+double overlap_element(int64_t i, int64_t j) {
+    return (i==j) ? 1.0 : 0.1/(1.0 + (i-j)*(i-j));
+}
+
+void test_distributed_eigen(World& world, int64_t n) {
+    DistributedMatrix<double> A = column_distributed_matrix<double>(world, n, n);
+    DistributedMatrix<double> B = column_distributed_matrix<double>(world, n, n);
+    A.fill(symmetric_element);
+    B.fill(overlap_element);
+    Tensor<double> a(n,n), b(n,n), v(n,n);
+    A.copy_to_replicated(a);
+    B.copy_to_replicated(b);
+    const double anorm = a.normf();
+
+    DistributedMatrix<double> V;
+    Tensor<double> e;
+
+    // A*v^T = v^T*e and v*v^T = 1
+    distributed_syev(A, V, e);
+    V.copy_to_replicated(v);
+    for (int64_t i=1; i<n; ++i) MADNESS_CHECK(e(i-1) <= e(i));
+    Tensor<double> r = inner(a, v, 1, 1);
+    for (int64_t i=0; i<n; ++i) r(_,i).gaxpy(1.0, v(i,_), -e(i));
+    double err = r.normf()/anorm;
+    Tensor<double> vvt = inner(v, v, 1, 1);
+    for (int64_t i=0; i<n; ++i) vvt(i,i) -= 1.0;
+    double orth = vvt.normf();
+    if (world.rank() == 0) print("distributed_syev", n, err, orth);
+    MADNESS_CHECK(err < 1e-12*n && orth < 1e-12*n);
+
+    // A*v^T = B*v^T*e and v*B*v^T = 1
+    distributed_sygv(A, B, V, e);
+    V.copy_to_replicated(v);
+    for (int64_t i=1; i<n; ++i) MADNESS_CHECK(e(i-1) <= e(i));
+    r = inner(a, v, 1, 1);
+    Tensor<double> bv = inner(b, v, 1, 1);
+    for (int64_t i=0; i<n; ++i) r(_,i).gaxpy(1.0, bv(_,i), -e(i));
+    err = r.normf()/anorm;
+    vvt = inner(v, bv);
+    for (int64_t i=0; i<n; ++i) vvt(i,i) -= 1.0;
+    orth = vvt.normf();
+    if (world.rank() == 0) print("distributed_sygv", n, err, orth);
+    MADNESS_CHECK(err < 1e-12*n && orth < 1e-12*n);
+
+    // X*B*X = 1 with X symmetric
+    DistributedMatrix<double> X = distributed_lowdin(B);
+    X.copy_to_replicated(v);
+    vvt = inner(v, inner(b, v));
+    for (int64_t i=0; i<n; ++i) vvt(i,i) -= 1.0;
+    orth = vvt.normf();
+    err = (v - transpose(v)).normf();
+    if (world.rank() == 0) print("distributed_lowdin", n, err, orth);
+    MADNESS_CHECK(err < 1e-12*n && orth < 1e-12*n);
+}
+
+
 int main(int argc, char** argv) {
     initialize(argc, argv);
     World world(SafeMPI::COMM_WORLD);
@@ -68,6 +129,8 @@ int main(int argc, char** argv) {
                 }
             }
         }
+
+        for (int64_t n : {1, 2, 3, 8, 17, 64}) test_distributed_eigen(world, n);
     }
     catch (const SafeMPI::Exception& e) {
         print(e);
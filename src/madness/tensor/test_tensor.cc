@@ -33,6 +33,7 @@
 /// \brief New test code for Tensor class using Google unit test
 
 #include <madness/tensor/tensor.h>
+#include <madness/tensor/tensor_expr.h>
 #include <madness/world/print.h>
 
 #ifdef MADNESS_HAS_GOOGLE_TEST
@@ -415,6 +416,38 @@ namespace {
         ITERATOR3(b,ASSERT_EQ(b(_i,_j,_k), a(_j,_i,_k)));
     }
 
+    TYPED_TEST(TensorTest, Expressions) {
+        using madness::lazy;
+        madness::Tensor<TypeParam> a(5,6,7), b(5,6,7), c(5,6,7);
+        a.fillindex();
+        b.fillrandom();
+        c.fillrandom();
+        const TypeParam two(2);
+
+        madness::Tensor<TypeParam> r = (lazy(a) - b)*two + c;
+        madness::Tensor<TypeParam> ref = (a - b)*two + c;
+        ITERATOR3(r,ASSERT_EQ(r(IND3),ref(IND3)));
+
+        r = evaluate(madness::emul(lazy(a), c) - b);
+        ref = copy(a).emul(c) - b;
+        ITERATOR3(r,ASSERT_EQ(r(IND3),ref(IND3)));
+
+        // non-contiguous operands and destination
+        madness::Tensor<TypeParam> s = copy(c);
+        assign(s(madness::Slice(0,3,2),_,_), lazy(a(madness::Slice(1,4,2),_,_)) + b(madness::Slice(1,4,2),_,_));
+        ITERATOR3(s,ASSERT_EQ(s(_i,_j,_k), (_i%2==0 && _i<4) ? a(_i+1,_j,_k) + b(_i+1,_j,_k) : c(_i,_j,_k)));
+
+        s = copy(c);
+        gaxpy(s(_,_,madness::Slice(1,-1,2)), TypeParam(1), -lazy(a(_,_,madness::Slice(0,-2,2))), two);
+        ITERATOR3(s,ASSERT_EQ(s(_i,_j,_k), (_k%2) ? c(_i,_j,_k) - two*a(_i,_j,_k-1) : c(_i,_j,_k)));
+
+        EXPECT_TRUE(check(madness::normf(lazy(a) - a*two), (a - a*two).normf()));
+        EXPECT_TRUE(check(madness::sum(lazy(a) + b), (a + b).sum()));
+
+        madness::Tensor<TypeParam> d(5,6,8);
+        EXPECT_THROW(madness::Tensor<TypeParam>(lazy(a) + d), madness::TensorException);
+    }
+
 //     TYPED_TEST(TensorTest, Container) {
 //         typedef madness::ConcurrentHashMap< int, Tensor<TypeParam> > containerT;
 //         static const int N = 100;
@@ -0,0 +1,197 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+
+/// \file bench_world.cc
+/// \brief Benchmarks of the hash map, task queue and messaging
+
+/// Run with \c --json=file to keep the results and \c --quick to only
+/// check that the benchmarks run.  Ping-pong needs at least two processes.
+
+#define WORLD_INSTANTIATE_STATIC_TEMPLATES
+#include <madness/world/MADworld.h>
+#include <madness/world/worldhashmap.h>
+#include <madness/world/dqueue.h>
+#include <madness/world/benchmark.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace madness;
+
+typedef ConcurrentHashMap<long,long> mapT;
+
+/// Inserts a range of keys into a map ... one task per thread
+class HashInsertTask : public TaskInterface {
+    mapT& map;
+    const long lo, hi;
+public:
+    HashInsertTask(mapT& map, long lo, long hi) : map(map), lo(lo), hi(hi) {}
+
+    void run(World& world) {
+        for (long i=lo; i<hi; ++i) map.insert(mapT::datumT(i*7919,i));
+    }
+};
+
+void bench_hashmap(World& world, BenchmarkRecorder& bench) {
+    const long n = bench.quick() ? 10000 : 1000000;
+    const std::string size = std::to_string(n);
+    mapT map;
+
+    bench.run("hashmap insert " + size, [&] {
+        map.clear();
+        for (long i=0; i<n; ++i) map.insert(mapT::datumT(i*7919,i));
+    }, 5, n, "op");
+
+    bench.run("hashmap find " + size, [&] {
+        long sum = 0;
+        for (long i=0; i<n; ++i) sum += map.find(i*7919)->second;
+        MADNESS_CHECK(sum == n*(n-1)/2);
+    }, 5, n, "op");
+
+    bench.run("hashmap accessor " + size, [&] {
+        for (long i=0; i<n; ++i) {
+            mapT::accessor acc;
+            map.find(acc, i*7919);
+            acc->second += 1;
+        }
+    }, 5, n, "op");
+
+    bench.run("hashmap insert+erase " + size, [&] {
+        map.clear();
+        for (long i=0; i<n; ++i) map.insert(mapT::datumT(i*7919,i));
+        for (long i=0; i<n; ++i) map.erase(i*7919);
+    }, 5, 2*n, "op");
+
+    const int ntask = ThreadPool::size() + 1;
+    bench.run("hashmap threaded insert " + size, [&] {
+        map.clear();
+        for (int t=0; t<ntask; ++t) world.taskq.add(new HashInsertTask(map, t*n/ntask, (t+1)*n/ntask));
+        world.taskq.fence();
+        MADNESS_CHECK(long(map.size()) == n);
+    }, 5, n, "op");
+}
+
+void bench_dqueue(World& world, BenchmarkRecorder& bench) {
+    const long n = bench.quick() ? 10000 : 1000000;
+    const std::string size = std::to_string(n);
+    DQueue<long> q;
+
+    bench.run("dqueue push_back+pop_front " + size, [&] {
+        for (long i=0; i<n; ++i) q.push_back(i);
+        long sum = 0;
+        for (long i=0; i<n; ++i) sum += q.pop_front(false).first;
+        MADNESS_CHECK(sum == n*(n-1)/2);
+    }, 5, 2*n, "op");
+
+    bench.run("dqueue push_front+pop_front " + size, [&] {
+        for (long i=0; i<n; ++i) q.push_front(i);
+        for (long i=0; i<n; ++i) q.pop_front(false);
+    }, 5, 2*n, "op");
+
+    const int nbuf = 64;
+    long buf[nbuf];
+    bench.run("dqueue push_back+pop_front(64) " + size, [&] {
+        for (long i=0; i<n; ++i) q.push_back(i);
+        long ngot = 0;
+        while (ngot < n) ngot += q.pop_front(nbuf, buf, false);
+    }, 5, 2*n, "op");
+}
+
+/// Target of the messaging benchmarks
+class Echo : public WorldObject<Echo> {
+    AtomicInt nrecv;
+public:
+    Echo(World& world) : WorldObject<Echo>(world) {
+        nrecv = 0;
+        process_pending();
+    }
+
+    long echo(long i) {return i;}
+
+    std::vector<double> echo_buf(const std::vector<double>& buf) {return buf;}
+
+    void recv(long) {nrecv++;}
+
+    long nreceived() {return nrecv;}
+};
+
+void bench_messages(World& world, BenchmarkRecorder& bench) {
+    Echo echo(world);
+    world.gop.fence();
+    const ProcessID me = world.rank();
+    const ProcessID np = world.size();
+
+    if (np > 1) {
+        const long n = bench.quick() ? 100 : 10000;
+        bench.run("rmi ping-pong", [&] {
+            if (me == 0) {
+                for (long i=0; i<n; ++i) MADNESS_CHECK(echo.send(1, &Echo::echo, i).get() == i);
+            }
+        }, 5, n, "msg");
+
+        const std::vector<double> buf(1024*1024/sizeof(double), 1.0);
+        const long nbuf = bench.quick() ? 4 : 100;
+        bench.run("rmi ping-pong 1MB", [&] {
+            if (me == 0) {
+                for (long i=0; i<nbuf; ++i) echo.send(1, &Echo::echo_buf, buf).get();
+            }
+        }, 5, 2.0*nbuf*1024*1024, "byte");
+    }
+    else if (me == 0) {
+        std::printf("skipping rmi ping-pong ... it needs at least two processes\n");
+    }
+
+    // Every process streams messages to the next one
+    const long n = bench.quick() ? 1000 : 100000;
+    const ProcessID dest = (me + 1) % np;
+    long nexpected = 0;
+    bench.run("active message throughput", [&] {
+        for (long i=0; i<n; ++i) echo.send(dest, &Echo::recv, i);
+        world.gop.fence();
+        nexpected += n;
+    }, 5, n*np, "msg");
+    MADNESS_CHECK(echo.nreceived() == nexpected);
+}
+
+int main(int argc, char** argv) {
+    World& world = initialize(argc, argv);
+    {
+        BenchmarkRecorder bench(world, "world", argc, argv);
+        bench_hashmap(world, bench);
+        bench_dqueue(world, bench);
+        bench_messages(world, bench);
+        bench.write();
+        world.gop.fence();
+    }
+    finalize();
+    return 0;
+}
@@ -0,0 +1,239 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_WORLD_BENCHMARK_H__INCLUDED
+#define MADNESS_WORLD_BENCHMARK_H__INCLUDED
+
+/// \file benchmark.h
+/// \brief Timing of benchmarks with the results written as JSON
+
+#include <madness/world/MADworld.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace madness {
+
+    /// Times a suite of benchmarks and writes the results as JSON
+
+    /// Each benchmark is a callable that is run once untimed and then
+    /// \c nrep times, keeping the minimum, median and mean wall time.  If
+    /// the callable does \c work units of work per call (flops, messages,
+    /// items ...) the rate at the minimum time is recorded too.  Callables
+    /// that communicate must be called on all processes; the others run on
+    /// every process and rank 0 reports its own times.
+    ///
+    /// The memory used by a case may be recorded as well.
+    ///
+    /// The command line options \c --json=file (results file, default
+    /// standard output) and \c --quick (fewer and smaller cases, for
+    /// checking that the benchmarks run) are understood.  The file holds
+    /// \code
+    /// {"suite": "...", "context": {"host": ..., "nproc": ..., "nthread": ..., "date": ...},
+    ///  "benchmarks": [{"name": ..., "nrep": ..., "min": ..., "median": ..., "mean": ...,
+    ///                  "work": ..., "unit": ..., "rate": ...}, ...],
+    ///  "memory": [{"name": ..., "bytes": ...}, ...]}
+    /// \endcode
+    /// with times in seconds; \c bin/compare_benchmarks.py compares two of them.
+    class BenchmarkRecorder {
+        struct Result {
+            std::string name;
+            long nrep;
+            double min, median, mean;
+            double work;
+            std::string unit;
+        };
+
+        World& world;
+        std::string suite;
+        std::string filename;
+        bool quick_;
+        std::vector<Result> results;
+        std::vector< std::pair<std::string,double> > memory_results;
+
+        static std::string quote(const std::string& s) {
+            std::string q = "\"";
+            for (char c : s) {
+                if (c == '"' || c == '\\') q += '\\';
+                q += c;
+            }
+            return q + "\"";
+        }
+
+    public:
+        /// Makes a recorder for a suite, taking the options from the command line
+
+        /// \param[in] world The world whose rank 0 writes the results.
+        /// \param[in] suite The name of the suite.
+        /// \param[in] argc The number of command line arguments.
+        /// \param[in] argv The command line arguments.
+        BenchmarkRecorder(World& world, const std::string& suite, int argc, char** argv)
+            : world(world), suite(suite), quick_(false)
+        {
+            for (int i=1; i<argc; ++i) {
+                if (std::strncmp(argv[i], "--json=", 7) == 0) filename = argv[i] + 7;
+                else if (std::strcmp(argv[i], "--quick") == 0) quick_ = true;
+            }
+        }
+
+        /// True if only a quick check was asked for
+        bool quick() const {return quick_;}
+
+        /// Number of repetitions, reduced in quick mode
+
+        /// \param[in] nrep The number of repetitions for a full run.
+        /// \return The number of repetitions to use.
+        long reps(long nrep) const {return quick_ ? std::min(nrep,2l) : nrep;}
+
+        /// Runs and times a benchmark
+
+        /// \param[in] name The name of the benchmark, unique within the suite.
+        /// \param[in] op The callable to time.
+        /// \param[in] nrep The number of timed calls.
+        /// \param[in] work The work done per call, or zero.
+        /// \param[in] unit The unit of the work.
+        template <typename opT>
+        void run(const std::string& name, opT op, long nrep, double work=0.0, const std::string& unit="") {
+            nrep = std::max(reps(nrep), 1l);
+            op();
+            world.gop.fence();
+            std::vector<double> times(nrep);
+            for (long i=0; i<nrep; ++i) {
+                const double start = wall_time();
+                op();
+                times[i] = wall_time() - start;
+            }
+            world.gop.fence();
+            add(name, times, work, unit);
+        }
+
+        /// Adds the times of a benchmark timed elsewhere
+
+        /// \param[in] name The name of the benchmark.
+        /// \param[in] times The wall time of each repetition.
+        /// \param[in] work The work done per repetition, or zero.
+        /// \param[in] unit The unit of the work.
+        void add(const std::string& name, std::vector<double> times, double work=0.0, const std::string& unit="") {
+            MADNESS_ASSERT(!times.empty());
+            std::sort(times.begin(), times.end());
+            Result r;
+            r.name = name;
+            r.nrep = times.size();
+            r.min = times.front();
+            r.median = times[times.size()/2];
+            r.mean = 0.0;
+            for (double t : times) r.mean += t;
+            r.mean /= times.size();
+            r.work = work;
+            r.unit = unit;
+            results.push_back(r);
+
+            if (world.rank() == 0) {
+                std::printf("%-50s %12.4e s", name.c_str(), r.min);
+                if (work > 0.0 && r.min > 0.0) std::printf(" %12.4e %s/s", work/r.min, unit.c_str());
+                std::printf("\n");
+                std::fflush(stdout);
+            }
+        }
+
+        /// Records the memory used by a case
+
+        /// \param[in] name The name of the case.
+        /// \param[in] bytes The memory in bytes, summed over all processes.
+        void memory(const std::string& name, double bytes) {
+            memory_results.push_back(std::make_pair(name, bytes));
+            if (world.rank() == 0) {
+                std::printf("%-50s %12.4e bytes\n", name.c_str(), bytes);
+                std::fflush(stdout);
+            }
+        }
+
+        /// Writes the results ... rank 0 only
+        void write() const {
+            if (world.rank() != 0) return;
+
+            char host[256] = "unknown";
+            gethostname(host, sizeof(host)-1);
+            char date[64];
+            std::time_t now = std::time(nullptr);
+            std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+            std::ostringstream s;
+            s.precision(6);
+            s << std::scientific;
+            s << "{\n  \"suite\": " << quote(suite) << ",\n";
+            s << "  \"context\": {\"host\": " << quote(host) << ", \"nproc\": " << world.size()
+              << ", \"nthread\": " << ThreadPool::size()+1 << ", \"quick\": " << (quick_ ? "true" : "false")
+              << ", \"date\": " << quote(date) << "},\n";
+            s << "  \"benchmarks\": [";
+            for (std::size_t i=0; i<results.size(); ++i) {
+                const Result& r = results[i];
+                s << (i ? ",\n" : "\n") << "    {\"name\": " << quote(r.name) << ", \"nrep\": " << r.nrep
+                  << ", \"min\": " << r.min << ", \"median\": " << r.median << ", \"mean\": " << r.mean;
+                if (r.work > 0.0) {
+                    s << ", \"work\": " << r.work << ", \"unit\": " << quote(r.unit)
+                      << ", \"rate\": " << (r.min > 0.0 ? r.work/r.min : 0.0);
+                }
+                s << "}";
+            }
+            s << "\n  ]";
+            if (!memory_results.empty()) {
+                s << ",\n  \"memory\": [";
+                for (std::size_t i=0; i<memory_results.size(); ++i) {
+                    s << (i ? ",\n" : "\n") << "    {\"name\": " << quote(memory_results[i].first)
+                      << ", \"bytes\": " << memory_results[i].second << "}";
+                }
+                s << "\n  ]";
+            }
+            s << "\n}\n";
+
+            if (filename.empty()) {
+                std::cout << s.str();
+            }
+            else {
+                std::ofstream f(filename.c_str());
+                f << s.str();
+                if (!f) MADNESS_EXCEPTION("BenchmarkRecorder: failed writing the results", 0);
+            }
+        }
+    };
+
+} // namespace madness
+
+#endif // MADNESS_WORLD_BENCHMARK_H__INCLUDED
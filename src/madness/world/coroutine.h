@@ -0,0 +1,179 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_WORLD_COROUTINE_H__INCLUDED
+#define MADNESS_WORLD_COROUTINE_H__INCLUDED
+
+/**
+ \file coroutine.h
+ \brief Makes \c Future awaitable and lets coroutines returning a \c Future
+    run as tasks in the \c ThreadPool.
+ \ingroup futures
+
+ Requires a compiler with C++20 coroutine support; otherwise this header
+ is empty and \c MADNESS_HAS_COROUTINES is not defined.
+
+ A coroutine returning \c Future<T> is started as a task in the thread pool
+ and returns its (unassigned) result future immediately to the caller. A
+ \c co_await on an unassigned future suspends the coroutine and frees the
+ worker thread; the coroutine is resumed as a new pool task once the future
+ is assigned:
+ \code
+ Future<double> sum(World& world, const Future<double>& a, const Future<double>& b) {
+     double x = co_await a;
+     double y = co_await b;
+     co_return x+y;
+ }
+ \endcode
+ Suspended coroutines are not tracked by \c WorldTaskQueue::fence(); wait on
+ the returned future instead.
+*/
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <coroutine>
+#include <utility>
+#include <madness/world/thread.h>
+#include <madness/world/future.h>
+
+#define MADNESS_HAS_COROUTINES 1
+
+namespace madness {
+
+    /// \addtogroup futures
+    /// @{
+
+    /// Pool task that resumes a suspended coroutine.
+    class CoroutineResumeTask : public PoolTaskInterface {
+        std::coroutine_handle<> handle; ///< The coroutine to resume.
+
+    public:
+        explicit CoroutineResumeTask(std::coroutine_handle<> handle)
+            : PoolTaskInterface(), handle(handle) {}
+
+        void run(const TaskThreadEnv& env) {
+            handle.resume();
+        }
+    };
+
+
+    /// Awaitable that suspends a coroutine until the thread pool runs it.
+    struct ThreadPoolAwaiter {
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) {
+            ThreadPool::add(new CoroutineResumeTask(h));
+        }
+        void await_resume() const noexcept {}
+    };
+
+
+    /// Awaitable wrapper of a \c Future.
+
+    /// If the future is not yet assigned the coroutine registers itself as
+    /// a callback and is resumed in a new pool task upon assignment.
+    /// \tparam T The type of the future.
+    template <typename T>
+    class FutureAwaiter : public CallbackInterface {
+        Future<T> f;                    ///< The awaited future.
+        std::coroutine_handle<> handle; ///< The suspended coroutine.
+
+    public:
+        explicit FutureAwaiter(const Future<T>& f) : f(f), handle() {}
+
+        bool await_ready() const { return f.probe(); }
+
+        /// \note The coroutine may be resumed on another thread before
+        ///     this returns, so no member may be touched after registration.
+        void await_suspend(std::coroutine_handle<> h) {
+            handle = h;
+            f.register_callback(this);
+        }
+
+        T await_resume() { return f.get(); }
+
+        void notify() {
+            ThreadPool::add(new CoroutineResumeTask(handle));
+        }
+    };
+
+
+    /// Awaiting a \c Future makes the calling coroutine wait for its assignment.
+    template <typename T>
+    FutureAwaiter<T> operator co_await(const Future<T>& f) {
+        return FutureAwaiter<T>(f);
+    }
+
+    /// \c Future<void> is always assigned.
+    inline std::suspend_never operator co_await(const Future<void>&) {
+        return {};
+    }
+
+
+    /// Promise type of coroutines returning \c Future<T>.
+
+    /// The coroutine body is run in the thread pool, and the value given
+    /// to \c co_return is assigned to the returned future.
+    /// \tparam T The type of the result.
+    template <typename T>
+    struct FuturePromise {
+        Future<T> result; ///< Local future handed out to the caller.
+
+        Future<T> get_return_object() { return result; }
+        ThreadPoolAwaiter initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+
+        template <typename U>
+        void return_value(U&& value) {
+            result.set(std::forward<U>(value));
+        }
+
+        /// Exceptions are passed on to the thread pool, as for regular tasks.
+        void unhandled_exception() { throw; }
+    };
+
+    /// @}
+
+} // namespace madness
+
+
+namespace std {
+
+    /// Use \c FuturePromise for coroutines returning a \c Future.
+    template <typename T, typename... argsT>
+    struct coroutine_traits<madness::Future<T>, argsT...> {
+        typedef madness::FuturePromise<T> promise_type;
+    };
+
+} // namespace std
+
+#endif // __cpp_impl_coroutine
+
+#endif // MADNESS_WORLD_COROUTINE_H__INCLUDED
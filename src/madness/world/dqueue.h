@@ -217,6 +217,19 @@ namespace madness {
         /// Insert element at back of queue (default is just one copy)
         void push_back(const T& value, int ncopy=1);
 
+        /// Insert value at front of queue bypassing the prebuffer of this thread
+        void push_front_unbuffered(const T& value) {
+            madness::ScopedMutex<CONDITION_VARIABLE_TYPE> obolus(this);
+            push_front_with_lock(value);
+        }
+
+        /// Insert element at back of queue bypassing the prebuffer of this thread
+        void push_back_unbuffered(const T& value, int ncopy=1) {
+            madness::ScopedMutex<CONDITION_VARIABLE_TYPE> obolus(this);
+            while (ncopy--)
+                push_back_with_lock(value);
+        }
+
         template <typename opT>
         void scan(opT& op) {
             madness::ScopedMutex<CONDITION_VARIABLE_TYPE> obolus(this);
@@ -243,7 +256,39 @@ namespace madness {
         int pop_front(int nmax, T* r, bool wait) {
             madness::ScopedMutex<CONDITION_VARIABLE_TYPE> obolus(this);
 	    flush_prebuf();
+            return pop_front_with_lock(nmax, r, wait);
+        }
+
+        /// Pop multiple values off the front of queue without waiting ... used to steal work
+
+        /// As pop_front() but the calling thread's prebuffer is left alone, so
+        /// that values it buffered for its own queue are not put into this one.
+        int steal_front(int nmax, T* r) {
+            if (n == 0) return 0;
+            madness::ScopedMutex<CONDITION_VARIABLE_TYPE> obolus(this);
+            return pop_front_with_lock(nmax, r, false);
+        }
+
+        /// Pop value off the front of queue
+        std::pair<T,bool> pop_front(bool wait) {
+            T r;
+            int ngot = pop_front(1, &r, wait);
+            return std::pair<T,bool>(r,ngot==1);
+        }
+
+        size_t size() const {
+            return n;
+        }
+
+        bool empty() const;
+
+        const DQStats& get_stats() const {
+            return stats;
+        }
 
+    private:
+        int pop_front_with_lock(int nmax, T* r, bool wait) {
+            // ASSUME WE ALREADY HAVE THE MUTEX WHEN IN HERE
             size_t nn = n;
 
             if (nn==0 && wait) {
@@ -302,23 +347,6 @@ namespace madness {
                 return 0;
             }
         }
-
-        /// Pop value off the front of queue
-        std::pair<T,bool> pop_front(bool wait) {
-            T r;
-            int ngot = pop_front(1, &r, wait);
-            return std::pair<T,bool>(r,ngot==1);
-        }
-
-        size_t size() const {
-            return n;
-        }
-
-        bool empty() const;
-
-        const DQStats& get_stats() const {
-            return stats;
-        }
     };
 
 #if defined(MADNESS_DQ_USE_PREBUF) && !defined(MADNESS_CXX_COMPILER_IS_ICC)
@@ -0,0 +1,83 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+
+#include <madness/world/MADworld.h>
+#include <madness/world/coroutine.h>
+
+using namespace madness;
+
+#ifdef MADNESS_HAS_COROUTINES
+
+Future<long> add(const Future<long>& a, const Future<long>& b) {
+    long x = co_await a;
+    long y = co_await b;
+    co_return x+y;
+}
+
+/// recursive sum of 1..n, each level waiting on the next without blocking a thread
+Future<long> sum(long n) {
+    if (n==0) co_return 0l;
+    long rest = co_await sum(n-1);
+    co_return n+rest;
+}
+
+int main(int argc, char** argv) {
+    madness::initialize(argc,argv);
+    {
+        madness::World world(SafeMPI::COMM_WORLD);
+
+        Future<long> a, b;
+        Future<long> c = add(a,b);
+        a.set(2l);
+        b.set(3l);
+        Future<long> s = sum(1000);
+
+        long cc = c.get();
+        long ss = s.get();
+        print("co_await result", cc, ss);
+        MADNESS_CHECK(cc==5);
+        MADNESS_CHECK(ss==500500);
+        world.gop.fence();
+    }
+    madness::finalize();
+    return 0;
+}
+
+#else
+
+#include <iostream>
+int main() {
+    std::cout << "coroutines require a C++20 compiler\n";
+    return 0;
+}
+
+#endif
@@ -173,7 +173,9 @@ void test1(World& world) {
         world.gop.fence(); total = double_count; world.gop.sum(total);
         if (world.rank() == 0) print("count after making", total);
         
-        pmap0->redistribute(world, pmap1);
+        WorldDCRedistributeStats stats = pmap0->redistribute(world, pmap1);
+        MADNESS_CHECK(stats.nentry == ((world.size() > 1) ? 300u : 0u));
+        MADNESS_CHECK((stats.nmsg > 0) == (stats.nentry > 0));
         
         world.gop.fence(); total = double_count; world.gop.sum(total);
         if (world.rank() == 0) print("count after redistributing", total);
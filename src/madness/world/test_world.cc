@@ -1136,6 +1136,62 @@ void test13(World& world) {
     world.gop.fence();
 }
 
+void test14(World& world) {
+    PROFILE_FUNC;
+    // Global reductions long enough to be pipelined in several segments
+    const long np = world.size();
+    const long me = world.rank();
+    const std::size_t n = 1000003;
+
+    std::vector<double> a(n);
+    for (std::size_t i=0; i<n; ++i) a[i] = me + double(i);
+    world.gop.sum(a.data(), n);
+    for (std::size_t i=0; i<n; ++i) {
+        MADNESS_CHECK(a[i] == double(np*(np-1)/2) + np*double(i));
+    }
+
+    std::vector<long> b(n);
+    for (std::size_t i=0; i<n; ++i) b[i] = (i%np == std::size_t(me)) ? long(i) : -1;
+    world.gop.max(b.data(), n);
+    for (std::size_t i=0; i<n; ++i) MADNESS_CHECK(b[i] == long(i));
+
+    // Non-blocking reduction overlapped with a blocking one
+    std::vector<int> c(n, 1);
+    int d = 1;
+    Future<bool> done = world.gop.sum_async(c.data(), n);
+    world.gop.sum(d);
+    MADNESS_CHECK(done.get());
+    MADNESS_CHECK(d == np);
+    for (std::size_t i=0; i<n; ++i) MADNESS_CHECK(c[i] == np);
+
+    print("test14 (global reductions) OK");
+    world.gop.fence();
+}
+
+int task_domain() {
+    return ThreadPool::domain();
+}
+
+void test15(World& world) {
+    PROFILE_FUNC;
+    // Affinity hints are kept alongside the other attributes
+    TaskAttributes attr = TaskAttributes::affinity(0x12345, TaskAttributes::hipri());
+    MADNESS_CHECK(attr.is_high_priority() && attr.has_affinity_hint());
+    MADNESS_CHECK(attr.get_affinity_hint() == 0x2345);
+    attr.clear_affinity_hint();
+    MADNESS_CHECK(attr.is_high_priority() && !attr.has_affinity_hint());
+
+    // Hinted tasks run in some domain of the pool (or in the main thread)
+    const int ndomain = ThreadPool::num_domains();
+    const int ntask = 1000;
+    std::vector< Future<int> > v(ntask);
+    for (int i=0; i<ntask; ++i) v[i] = world.taskq.add(&task_domain, TaskAttributes::affinity(i));
+    for (int i=0; i<ntask; ++i) MADNESS_CHECK(v[i].get() >= -1 && v[i].get() < ndomain);
+
+    print("test15 (task affinity) OK with", ndomain, "domains");
+    world.gop.fence();
+}
+
 inline bool is_odd(int i) {
     return i & 0x1;
 }
@@ -1303,6 +1359,8 @@ int main(int argc, char** argv) {
         //test11(world);
         test12(world);
         test13(world);
+        test14(world);
+        test15(world);
 
         for (int i=0; i<10; ++i) {
           print("REPETITION",i);
@@ -43,8 +43,11 @@
 #include <madness/world/worldpapi.h>
 #include <madness/world/safempi.h>
 #include <madness/world/atomicint.h>
+#include <algorithm>
 #include <cstring>
 #include <fstream>
+#include <sstream>
+#include <string>
 
 #if defined(HAVE_IBMBGQ) and defined(HPM)
 extern "C" unsigned int HPM_Prof_init_thread(void);
@@ -74,6 +77,7 @@ namespace madness {
 
     ThreadPool* ThreadPool::instance_ptr = 0;
     double ThreadPool::await_timeout = 900.0;
+    thread_local int ThreadPool::this_domain = -1;
 #if HAVE_INTEL_TBB
     std::unique_ptr<tbb::global_control> ThreadPool::tbb_control = nullptr;
 #endif
@@ -262,6 +266,60 @@ namespace madness {
 #endif
     }
 
+    void ThreadBase::set_affinity(const std::vector<int>& cpus) {
+#ifndef ON_A_MAC
+        // Only CPUs the process may use ... leave the thread alone if there are none
+        cpu_set_t allowed, mask;
+        CPU_ZERO(&mask);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) == -1) return;
+        for (int cpu : cpus) {
+            if (CPU_ISSET(cpu,&allowed)) CPU_SET(cpu,&mask);
+        }
+        if (CPU_COUNT(&mask) == 0) return;
+        if (sched_setaffinity(0, sizeof(mask), &mask) == -1) {
+            perror("system error message");
+            std::cout << "ThreadBase: set_affinity: Could not set cpu affinity" << std::endl;
+        }
+#endif
+    }
+
+    // Parses a Linux cpu list such as "0-3,8,10-11"
+    static std::vector<int> parse_cpu_list(const std::string& list) {
+        std::vector<int> cpus;
+        std::stringstream ss(list);
+        std::string range;
+        while (std::getline(ss, range, ',')) {
+            int lo, hi;
+            const int n = sscanf(range.c_str(), "%d-%d", &lo, &hi);
+            if (n == 1) hi = lo;
+            else if (n != 2) continue;
+            for (int i=lo; i<=hi; ++i) cpus.push_back(i);
+        }
+        return cpus;
+    }
+
+    std::vector< std::vector<int> > ThreadBase::numa_domains() {
+        std::vector< std::vector<int> > domains;
+#if defined(__linux__)
+        std::ifstream online("/sys/devices/system/node/online");
+        std::string nodes;
+        if (online && std::getline(online, nodes)) {
+            for (int node : parse_cpu_list(nodes)) {
+                std::ifstream f("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+                std::string list;
+                if (!(f && std::getline(f, list))) continue;
+                std::vector<int> cpus = parse_cpu_list(list);
+                if (!cpus.empty()) domains.push_back(cpus);
+            }
+        }
+#endif
+        if (domains.empty()) {
+            domains.resize(1);
+            for (int i=0; i<num_hw_processors(); ++i) domains[0].push_back(i);
+        }
+        return domains;
+    }
+
 #if defined(HAVE_IBMBGQ) and defined(HPM)
   void ThreadBase::set_hpm_thread_env(int hpm_thread_id) {
     if (hpm_thread_id == ThreadBase::hpm_thread_id_all) {
@@ -338,9 +396,11 @@ namespace madness {
 #endif
     // The constructor is private to enforce the singleton model
     ThreadPool::ThreadPool(int nthread) :
-            threads(nullptr), main_thread(), nthreads(nthread), finish(false)
+            threads(nullptr), main_thread(), nthreads(nthread), finish(false),
+            ndomain(1), domain_queues(nullptr)
     {
         nfinished = 0;
+        next_domain = 0;
         instance_ptr = this;
         if (nthreads < 0) nthreads = default_nthread();
         MADNESS_ASSERT(nthreads >= 0);
@@ -388,6 +448,8 @@ namespace madness {
         tbb_control = std::make_unique<tbb::global_control>(tbb::global_control::max_allowed_parallelism, num_tbb_threads);
 #else
 
+        init_domains();
+
         try {
             if (nthreads > 0)
                 threads = new ThreadPoolThread[nthreads];
@@ -431,9 +493,39 @@ namespace madness {
         return nthread;
     }
 
+    // Splits the pool into NUMA domains with a queue and group of threads each
+    void ThreadPool::init_domains() {
+        std::vector< std::vector<int> > cpus = ThreadBase::numa_domains();
+        int n = cpus.size();
+        const char* cndomain = getenv("MAD_NUMA_DOMAINS");
+        if (cndomain) {
+            if (sscanf(cndomain, "%d", &n) != 1)
+                MADNESS_EXCEPTION("MAD_NUMA_DOMAINS is not an integer", 0);
+        }
+        n = std::max(1, std::min(n, nthreads));
+        if (n == 1) return;
+
+        // If the requested domains do not match the topology split the CPUs evenly
+        if (n != int(cpus.size())) {
+            const int ncpu = ThreadBase::num_hw_processors();
+            cpus.assign(n, std::vector<int>());
+            for (int i=0; i<ncpu; ++i) cpus[i*n/ncpu].push_back(i);
+        }
+
+        ndomain = n;
+        domain_cpus = cpus;
+        domain_queues = new DQueue<PoolTaskInterface*>[ndomain-1];
+    }
+
     void ThreadPool::thread_main(ThreadPoolThread* const thread) {
         PROFILE_MEMBER_FUNC(ThreadPool);
-        thread->set_affinity(2, thread->get_pool_thread_index());
+        const int ind = thread->get_pool_thread_index();
+        // Threads are grouped by index; explicit binding from MAD_BIND still wins
+        this_domain = ind*ndomain/nthreads;
+        if (ndomain > 1 && !ThreadBase::bind[2])
+            ThreadBase::set_affinity(domain_cpus[this_domain]);
+        else
+            thread->set_affinity(2, ind);
 
 #if !HAVE_PARSEC
 #define MULTITASK
@@ -489,6 +581,9 @@ namespace madness {
             }
         }
 
+        if(instance_ptr->ndomain > 1 && SafeMPI::COMM_WORLD.Get_rank() == 0 && !madness::quiet())
+            std::cout << "MADNESS thread pool split over " << instance_ptr->ndomain << " NUMA domains\n";
+
 #ifdef MADNESS_TASK_PROFILING
         // Initialize the output file name for the task profiler.
         profiling::TaskProfiler::output_file_name_ =
@@ -544,13 +639,27 @@ namespace madness {
 #if defined(HAVE_IBMBGQ) and defined(HPM)
 	if (ThreadBase::main_instrumented) HPM_Prof_stop(main_hpmctx);
 #endif
+        delete [] instance_ptr->domain_queues;
         delete instance_ptr;
         instance_ptr = nullptr;
     }
 
     // Returns queue statistics
     const DQStats& ThreadPool::get_stats() {
-        return instance()->queue.get_stats();
+        ThreadPool* pool = instance();
+        if (pool->ndomain == 1) return pool->queue.get_stats();
+
+        DQStats& sum = pool->domain_stats;
+        sum = DQStats();
+        for (int d=0; d<pool->ndomain; ++d) {
+            const DQStats& stats = pool->domain_queue(d).get_stats();
+            sum.npush_back += stats.npush_back;
+            sum.npush_front += stats.npush_front;
+            sum.npop_front += stats.npop_front;
+            sum.ngrow += stats.ngrow;
+            sum.nmax = std::max(sum.nmax, stats.nmax);
+        }
+        return sum;
     }
 
 #if defined(MADNESS_DQ_USE_PREBUF) && defined(MADNESS_CXX_COMPILER_IS_ICC)
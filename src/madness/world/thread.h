@@ -209,6 +209,19 @@ namespace madness {
         /// \param[in] ind Description needed.
         static void set_affinity(int logical_id, int ind=-1);
 
+        /// Binds the calling thread to a set of CPUs.
+
+        /// \param[in] cpus The CPUs the thread may run on.
+        static void set_affinity(const std::vector<int>& cpus);
+
+        /// Get the CPUs of each NUMA domain of this node.
+
+        /// On Linux the topology is read from \c /sys/devices/system/node;
+        /// domains without CPUs are skipped.  Elsewhere, or if the topology
+        /// cannot be read, all processors are returned as a single domain.
+        /// \return The CPUs of each domain.
+        static std::vector< std::vector<int> > numa_domains();
+
         /// \todo Brief description needed.
 
         /// \todo Descriptions needed.
@@ -287,6 +300,9 @@ namespace madness {
         static const unsigned long GENERATOR = 1ul<<8; ///< Mask for generator bit.
         static const unsigned long STEALABLE = GENERATOR<<1; ///< Mask for stealable bit.
         static const unsigned long HIGHPRIORITY = GENERATOR<<2; ///< Mask for priority bit.
+        static const unsigned long AFFINITY = GENERATOR<<3; ///< Mask for affinity hint bit.
+        static const unsigned long AFFINITY_SHIFT = 16; ///< Position of the affinity hint.
+        static const unsigned long AFFINITY_HINT = 0xfffful<<AFFINITY_SHIFT; ///< Mask for affinity hint.
 
         /// Sets the attributes to the desired values.
 
@@ -325,6 +341,20 @@ namespace madness {
             return flags&HIGHPRIORITY;
         }
 
+        /// Test if the task has an affinity hint.
+
+        /// \return True if an affinity hint was set, false otherwise.
+        bool has_affinity_hint() const {
+            return flags&AFFINITY;
+        }
+
+        /// Get the affinity hint.
+
+        /// \return The affinity hint, or zero if none was set.
+        unsigned long get_affinity_hint() const {
+            return (flags&AFFINITY_HINT)>>AFFINITY_SHIFT;
+        }
+
         /// Sets the generator attribute.
 
         /// \param[in] generator_hint The new value for the generator attribute.
@@ -353,6 +383,22 @@ namespace madness {
                 flags &= ~HIGHPRIORITY;
         }
 
+        /// Sets the affinity hint.
+
+        /// Tasks with the same hint are queued in the same NUMA domain of
+        /// the thread pool, so that the data they touch stays in the memory
+        /// of that domain.  Typically the hint is the hash of the key of the
+        /// data; only its low 16 bits are kept.
+        /// \param[in] hint The affinity hint.
+        void set_affinity_hint(unsigned long hint) {
+            flags = (flags & ~AFFINITY_HINT) | AFFINITY | ((hint<<AFFINITY_SHIFT) & AFFINITY_HINT);
+        }
+
+        /// Removes the affinity hint.
+        void clear_affinity_hint() {
+            flags &= ~(AFFINITY | AFFINITY_HINT);
+        }
+
         /// Set the number of threads.
 
         /// \attention Are you sure this is what you want to call? Only call
@@ -416,6 +462,17 @@ namespace madness {
             t.set_nthread(nthread);
             return t;
         }
+
+        /// Attributes with an affinity hint.
+
+        /// \param[in] hint The affinity hint (see \c set_affinity_hint()).
+        /// \param[in] attr The other attributes.
+        /// \return A copy of \c attr with the affinity hint set.
+        static TaskAttributes affinity(unsigned long hint, const TaskAttributes& attr = TaskAttributes()) {
+            TaskAttributes t(attr);
+            t.set_affinity_hint(hint);
+            return t;
+        }
     };
 
     /// Used to pass information about the thread environment to a user's task.
@@ -1161,13 +1218,21 @@ namespace madness {
         // Thread pool data
         ThreadPoolThread *threads; ///< Array of threads.
         ThreadPoolThread main_thread; ///< Placeholder for main thread tls.
-        DQueue<PoolTaskInterface*> queue; ///< Queue of tasks.
+        DQueue<PoolTaskInterface*> queue; ///< Queue of tasks (of domain 0).
         int nthreads; ///< Number of threads.
         volatile bool finish; ///< Set to true when time to stop.
         AtomicInt nfinished; ///< Thread pool exit counter.
 
+        // NUMA domains
+        int ndomain; ///< Number of NUMA domains the pool is split into.
+        DQueue<PoolTaskInterface*>* domain_queues; ///< Queues of domains 1,...,ndomain-1.
+        std::vector< std::vector<int> > domain_cpus; ///< CPUs of each domain.
+        AtomicInt next_domain; ///< Round robin domain for tasks without a home.
+        DQStats domain_stats; ///< Queue statistics summed over domains.
+
         // Static data
         static ThreadPool* instance_ptr; ///< Singleton pointer.
+        static thread_local int this_domain; ///< Domain of a pool thread or -1.
         static const int nmax = 128; ///< Number of task a worker thread will pop from the task queue
         static double await_timeout; ///< Waiter timeout.
 
@@ -1185,6 +1250,77 @@ namespace madness {
         /// \return The number of threads.
         int default_nthread();
 
+        /// Splits the pool into NUMA domains.
+
+        /// Each domain gets a group of threads, bound to its CPUs, and its
+        /// own task queue.  The number of domains is taken from the node
+        /// topology or from \c MAD_NUMA_DOMAINS (1 switches this off).
+        void init_domains();
+
+        /// The task queue of a domain.
+
+        /// \param[in] d The domain.
+        /// \return The queue of domain \c d.
+        DQueue<PoolTaskInterface*>& domain_queue(int d) {
+            return d ? domain_queues[d-1] : queue;
+        }
+
+        /// The domain in which a task is queued.
+
+        /// A task with an affinity hint goes to the domain selected by the
+        /// hint.  Others stay in the domain of the submitting pool thread or,
+        /// if submitted from outside the pool, are dealt out round robin.
+        /// \param[in] task The task.
+        /// \return The domain.
+        int task_domain(const PoolTaskInterface* task) {
+            if (task->has_affinity_hint()) return task->get_affinity_hint() % ndomain;
+            if (this_domain >= 0) return this_domain;
+            return (next_domain++) % ndomain;
+        }
+
+        /// Pops tasks for the calling thread.
+
+        /// With several domains a thread takes tasks from the queue of its
+        /// own domain and steals from the other domains only when its own
+        /// queue is empty.
+        /// \param[in] n The maximum number of tasks.
+        /// \param[out] taskbuf Array of at least \c n tasks.
+        /// \param[in] wait Block until a task is available or the pool finishes.
+        /// \return The number of tasks popped.
+        int pop_tasks(int n, PoolTaskInterface** taskbuf, bool wait) {
+            if (ndomain == 1) return queue.pop_front(n, taskbuf, wait);
+
+            const int d = (this_domain >= 0) ? this_domain : 0;
+            MutexWaiter waiter;
+            while (true) {
+                int ntask = domain_queue(d).pop_front(n, taskbuf, false);
+                for (int i=1; ntask==0 && i<ndomain; ++i)
+                    ntask = domain_queue((d+i)%ndomain).steal_front(n, taskbuf);
+                if (ntask || !wait || finish) return ntask;
+                waiter.wait();
+            }
+        }
+
+        /// Queues a task in its domain.
+
+        /// \param[in] task The task.
+        /// \param[in] task_threads The number of threads of the task.
+        void add_to_domain(PoolTaskInterface* task, int task_threads) {
+            const int d = task_domain(task);
+            DQueue<PoolTaskInterface*>& q = domain_queue(d);
+            // The prebuffer of a thread is flushed into the queue of its own
+            // domain so only tasks for that domain may go through it
+            const bool buffered = (d == (this_domain >= 0 ? this_domain : 0));
+            if (task->is_high_priority() && (task_threads == 1)) {
+                if (buffered) q.push_front(task);
+                else q.push_front_unbuffered(task);
+            }
+            else {
+                if (buffered) q.push_back(task, task_threads);
+                else q.push_back_unbuffered(task, task_threads);
+            }
+        }
+
        /// Run the next task.
 
         /// \todo Verify and complete this documentation.
@@ -1196,8 +1332,9 @@ namespace madness {
             MADNESS_EXCEPTION("run_task should not be called when using Intel TBB", 1);
 #else
 
-            if (!wait && queue.empty()) return false;
-            std::pair<PoolTaskInterface*,bool> t = queue.pop_front(wait);
+            if (!wait && ndomain == 1 && queue.empty()) return false;
+            std::pair<PoolTaskInterface*,bool> t;
+            t.second = (pop_tasks(1, &t.first, wait) == 1);
 #ifdef MADNESS_TASK_PROFILING
             profiling::TaskEventList* event_list =
                     this_thread->profiler().new_list(1);
@@ -1236,7 +1373,7 @@ namespace madness {
 #else
 
             PoolTaskInterface* taskbuf[nmax];
-            int ntask = queue.pop_front(nmax, taskbuf, wait);
+            int ntask = pop_tasks(nmax, taskbuf, wait);
 #ifdef MADNESS_TASK_PROFILING
             profiling::TaskEventList* event_list =
                     this_thread->profiler().new_list(ntask);
@@ -1285,7 +1422,7 @@ namespace madness {
 
 	void flush_prebuf() {
 #if !(defined(HAVE_INTEL_TBB) || defined(HAVE_PARSEC))
-	  queue.lock_and_flush_prebuf();
+	  domain_queue(this_domain >= 0 ? this_domain : 0).lock_and_flush_prebuf();
 #endif
 	}
 
@@ -1336,13 +1473,18 @@ namespace madness {
 #else
             if (!task) MADNESS_EXCEPTION("ThreadPool: inserting a NULL task pointer", 1);
             int task_threads = task->get_nthread();
+            ThreadPool* pool = instance();
+            if (pool->ndomain > 1) {
+                pool->add_to_domain(task, task_threads);
+                return;
+            }
             // Currently multithreaded tasks must be shoved on the end of the q
             // to avoid a race condition as multithreaded task is starting up
             if (task->is_high_priority() && (task_threads == 1)) {
-                instance()->queue.push_front(task);
+                pool->queue.push_front(task);
             }
             else {
-                instance()->queue.push_back(task, task_threads);
+                pool->queue.push_back(task, task_threads);
             }
 #endif // HAVE_INTEL_TBB
         }
@@ -1354,7 +1496,7 @@ namespace madness {
         /// \param[in,out] op Description needed.
         template <typename opT>
         void scan(opT& op) {
-            queue.scan(op);
+            for (int d=0; d<ndomain; ++d) domain_queue(d).scan(op);
         }
 
         /// Add a vector of tasks to the pool.
@@ -1414,7 +1556,24 @@ namespace madness {
 
         /// \return The number of tasks in the queue.
         static std::size_t queue_size() {
-            return instance()->queue.size();
+            ThreadPool* pool = instance();
+            std::size_t n = 0;
+            for (int d=0; d<pool->ndomain; ++d) n += pool->domain_queue(d).size();
+            return n;
+        }
+
+        /// Returns the number of NUMA domains the pool is split into.
+
+        /// \return The number of domains.
+        static int num_domains() {
+            return instance()->ndomain;
+        }
+
+        /// Returns the NUMA domain of the calling thread.
+
+        /// \return The domain of a pool thread or -1 for other threads.
+        static int domain() {
+            return this_domain;
         }
 
         /// Returns queue statistics.
@@ -40,6 +40,7 @@
 
 */
 
+#include <atomic>
 #include <functional>
 #include <set>
 
@@ -62,6 +63,16 @@ namespace madness {
     template <typename keyT>
     class WorldDCPmapInterface;
 
+    /// Data moved by a redistribution
+
+    /// \ingroup worlddc
+    struct WorldDCRedistributeStats {
+        std::size_t nentry = 0;     ///< No. of entries that moved
+        std::size_t nbyte = 0;      ///< No. of bytes sent
+        std::size_t nmsg = 0;       ///< No. of messages sent
+        double time = 0.0;          ///< Wall time of moving the data
+    };
+
     template <typename keyT>
     class WorldDCRedistributeInterface {
     public:
@@ -69,6 +80,8 @@ namespace madness {
         virtual void redistribute_phase1(const std::shared_ptr< WorldDCPmapInterface<keyT> >& newmap) = 0;
         virtual void redistribute_phase2() = 0;
         virtual void redistribute_phase3() = 0;
+        /// Adds the local data moved in phase 2 to the stats; called before phase 3
+        virtual void redistribute_stats(WorldDCRedistributeStats& stats) const {}
 	virtual ~WorldDCRedistributeInterface() {};
     };
 
@@ -113,7 +126,8 @@ namespace madness {
         /// new map and no objects will be registered in the current map.
         /// @param[in] world The associated world
         /// @param[in] newpmap The new process map
-        void redistribute(World& world, const std::shared_ptr< WorldDCPmapInterface<keyT> >& newpmap) {
+        /// @return The data moved, summed over all processes and containers
+        WorldDCRedistributeStats redistribute(World& world, const std::shared_ptr< WorldDCPmapInterface<keyT> >& newpmap) {
             print_data_sizes(world, "before redistributing");
             world.gop.fence();
             for (typename std::set<ptrT>::iterator iter = ptrs.begin();
@@ -122,6 +136,7 @@ namespace madness {
                 (*iter)->redistribute_phase1(newpmap);
             }
             world.gop.fence();
+            const double start = wall_time();
             for (typename std::set<ptrT>::iterator iter = ptrs.begin();
                  iter != ptrs.end();
                  ++iter) {
@@ -129,14 +144,26 @@ namespace madness {
                 newpmap->register_callback(*iter);
             }
             world.gop.fence();
+            WorldDCRedistributeStats stats;
+            stats.time = wall_time() - start;
             for (typename std::set<ptrT>::iterator iter = ptrs.begin();
                  iter != ptrs.end();
                  ++iter) {
+                (*iter)->redistribute_stats(stats);
 	         (*iter)->redistribute_phase3();
             }
             world.gop.fence();
             ptrs.clear();
+            world.gop.sum(stats.nentry);
+            world.gop.sum(stats.nbyte);
+            world.gop.sum(stats.nmsg);
+            world.gop.max(stats.time);
+            if (world.rank() == 0) {
+                madness::print("moved", stats.nentry, "entries", stats.nbyte, "bytes in",
+                               stats.nmsg, "messages in", stats.time, "s");
+            }
             newpmap->print_data_sizes(world, "after redistributing");
+            return stats;
         }
 
         /// Counts global number of entries in all containers associated with this process map
@@ -376,7 +403,15 @@ namespace madness {
         std::shared_ptr< WorldDCPmapInterface<keyT> > pmap;///< Function/class to map from keys to owning process
         const ProcessID me;                      ///< My MPI rank
         internal_containerT local;               ///< Locally owned data
-        std::vector<keyT>* move_list;            ///< Tempoary used to record data that needs redistributing
+        std::vector< std::vector<keyT> > move_list; ///< Temporary used to record data that needs redistributing, by destination
+        std::atomic<std::size_t> move_nbyte;     ///< Bytes sent in the current redistribution
+        std::atomic<std::size_t> move_nmsg;      ///< Messages sent in the current redistribution
+
+        /// Target size in bytes of the messages that carry redistributed data
+        static const std::size_t move_msg_bytes = std::size_t(1) << 24;
+
+        internal_containerT replicas;            ///< Read-only copies of remote entries
+        std::atomic<std::size_t> replica_nhit;   ///< Remote finds answered from the replicas
 
         /// Handles find request
         void find_handler(ProcessID requestor, const keyT& key, const RemoteReference< FutureImpl<iterator> >& ref) {
@@ -417,7 +452,12 @@ namespace madness {
                 : WorldObject< WorldContainerImpl<keyT, valueT, hashfunT> >(world)
                 , pmap(pm)
                 , me(world.mpi.rank())
-                , local(5011, hf) {
+                , local(5011, hf)
+                , move_list()
+                , move_nbyte(0)
+                , move_nmsg(0)
+                , replicas(101, hf)
+                , replica_nhit(0) {
             pmap->register_callback(this);
         }
 
@@ -429,7 +469,7 @@ namespace madness {
             return pmap;
         }
 
-        hashfunT& get_hash() const { return local.get_hash(); }
+        const hashfunT& get_hash() const { return local.get_hash(); }
 
         bool is_local(const keyT& key) const {
             return owner(key) == me;
@@ -477,6 +517,57 @@ namespace madness {
 
         void clear() {
             local.clear();
+            replicas.clear();
+        }
+
+        // Copies the selected local entries to the replicas of all other processes
+        template <typename predT>
+        void replicate(const predT& select) {
+            std::vector<unsigned char> buf;
+            for (int pass=0; pass<2; ++pass) {
+                archive::BufferOutputArchive count;
+                archive::BufferOutputArchive store(buf.data(), buf.size());
+                const archive::BufferOutputArchive& ar = (pass == 0) ? count : store;
+                for (internal_const_iteratorT iter=local.begin(); iter!=local.end(); ++iter) {
+                    if (select(iter->first, iter->second)) ar & iter->first & iter->second;
+                }
+                if (pass == 0) buf.resize(count.size());
+            }
+            if (buf.empty()) return;
+            for (ProcessID p=0; p<this->get_world().size(); ++p) {
+                if (p != me) this->send(p, &implT::replica_insert, buf);
+            }
+        }
+
+        // Inserts the entries packed by replicate
+        void replica_insert(const std::vector<unsigned char>& buf) {
+            archive::BufferInputArchive ar(buf.data(), buf.size());
+            while (ar.nbyte_avail() > 0) {
+                keyT key;
+                ar & key;
+                accessor acc;
+                replicas.insert(acc, key);
+                ar & acc->second;
+            }
+        }
+
+        void clear_replicas() {
+            replicas.clear();
+        }
+
+        const valueT* find_replica(const keyT& key) const {
+            if (replicas.size() == 0) return nullptr;
+            internal_const_iteratorT r = replicas.find(key);
+            if (r == replicas.end()) return nullptr;
+            return &(r->second);
+        }
+
+        std::size_t replica_size() const {
+            return replicas.size();
+        }
+
+        std::size_t replica_hits() const {
+            return replica_nhit;
         }
 
 
@@ -540,6 +631,13 @@ namespace madness {
             if (dest == me) {
                 return Future<iterator>(iterator(local.find(key)));
             } else {
+                if (replicas.size() > 0) {
+                    internal_iteratorT r = replicas.find(key);
+                    if (r != replicas.end()) {
+                        ++replica_nhit;
+                        return Future<iterator>(iterator(r));
+                    }
+                }
                 Future<iterator> result;
                 this->send(dest, &implT::find_handler, me, key, result.remote_ref(this->get_world()));
                 return result;
@@ -634,45 +732,75 @@ namespace madness {
         // First phase of redistributions changes pmap and makes list of stuff to move
         void redistribute_phase1(const std::shared_ptr< WorldDCPmapInterface<keyT> >& newpmap) {
             pmap = newpmap;
-            move_list = new std::vector<keyT>();
+            replicas.clear();
+            move_list.assign(this->get_world().size(), std::vector<keyT>());
+            move_nbyte = 0;
+            move_nmsg = 0;
             for (typename internal_containerT::iterator iter=local.begin(); iter!=local.end(); ++iter) {
-                if (owner(iter->first) != me) move_list->push_back(iter->first);
+                const ProcessID dest = owner(iter->first);
+                if (dest != me) move_list[dest].push_back(iter->first);
             }
         }
 
-	struct P2Op {
-	  implT * impl;
-	  typedef Range<typename std::vector<keyT>::const_iterator> rangeT;
-	  P2Op(implT* impl) : impl(impl) {}
-    	  P2Op(const P2Op& p) : impl(p.impl) {}
-	  bool operator()(typename rangeT::iterator& iterator) const {
-	    typename internal_containerT::iterator iter = impl->local.find(*iterator);
-	    MADNESS_ASSERT(iter != impl->local.end());
+        // Packs the data that moves to one process into a few large messages
+        void redistribute_send(ProcessID dest) {
+            const std::vector<keyT>& keys = move_list[dest];
+            std::size_t first = 0;
+            while (first < keys.size()) {
+                // Count the bytes of as many entries as fit into one message
+                archive::BufferOutputArchive count;
+                std::size_t last = first;
+                while (last < keys.size() && (last == first || count.size() < move_msg_bytes)) {
+                    internal_iteratorT iter = local.find(keys[last++]);
+                    MADNESS_ASSERT(iter != local.end());
+                    count & iter->first & iter->second;
+                }
 
-	    //impl->insert(*iter);
-	    impl->task(impl->owner(*iterator), &implT::insert, *iter);
+                std::vector<unsigned char> buf(count.size());
+                archive::BufferOutputArchive ar(buf.data(), buf.size());
+                for (std::size_t i=first; i<last; ++i) {
+                    internal_iteratorT iter = local.find(keys[i]);
+                    ar & iter->first & iter->second;
+                    local.erase(iter); // delete local copy of the data
+                }
+                move_nbyte += buf.size();
+                ++move_nmsg;
+                this->task(dest, &implT::redistribute_insert, buf);
+                first = last;
+            }
+        }
 
-	    impl->local.erase(iter); // delete local copy of the data
-	    return true;
-	  }
-	};
+        // Inserts the entries packed by redistribute_send
+        void redistribute_insert(const std::vector<unsigned char>& buf) {
+            archive::BufferInputArchive ar(buf.data(), buf.size());
+            while (ar.nbyte_avail() > 0) {
+                keyT key;
+                ar & key;
+                MADNESS_ASSERT(owner(key) == me);
+                accessor acc;
+                local.insert(acc, key);
+                ar & acc->second;
+            }
+        }
 
-        // Second phase moves data
+        // Second phase moves data, one task per destination
         void redistribute_phase2() {
-	  this->get_world().taskq.for_each(typename P2Op::rangeT(move_list->begin(), move_list->end()), P2Op(this));
-	    //std::vector<keyT>& mvlist = *move_list;
-            //for (unsigned int i=0; i<move_list->size(); ++i) {
-            //    typename internal_containerT::iterator iter = local.find(mvlist[i]);
-            //    MADNESS_ASSERT(iter != local.end());
-            //    insert(*iter);
-            //    local.erase(iter);
-            //}
-            //delete move_list;
+            for (ProcessID dest=0; dest<ProcessID(move_list.size()); ++dest) {
+                if (not move_list[dest].empty()) {
+                    this->get_world().taskq.add(*this, &implT::redistribute_send, dest);
+                }
+            }
+        }
+
+        void redistribute_stats(WorldDCRedistributeStats& stats) const {
+            for (const std::vector<keyT>& keys : move_list) stats.nentry += keys.size();
+            stats.nbyte += move_nbyte;
+            stats.nmsg += move_nmsg;
         }
 
         // Third phase cleans up
         void redistribute_phase3() {
-	   delete move_list;
+            move_list.clear();
         }
     };
 
@@ -721,6 +849,15 @@ namespace madness {
         inline void check_initialized() const {
             MADNESS_ASSERT(p);
         }
+
+        /// Attributes of a task on an item ... adds an affinity hint from the key
+
+        /// All tasks on an item then run in the same NUMA domain of its owner,
+        /// the one that first touched its data, unless the caller gave a hint.
+        TaskAttributes key_affinity(const keyT& key, const TaskAttributes& attr) const {
+            if (attr.has_affinity_hint()) return attr;
+            return TaskAttributes::affinity(p->get_hash()(key), attr);
+        }
     public:
 
         /// Makes an uninitialized container (no communication)
@@ -943,7 +1080,7 @@ namespace madness {
         }
 
 
-        /// Clears all \em local data (no communication)
+        /// Clears all \em local data and replicas (no communication)
 
         /// Invalidates all iterators
         void clear() {
@@ -951,6 +1088,48 @@ namespace madness {
             p->clear();
         }
 
+        /// Copies selected entries onto all processes as read-only replicas; collective
+
+        /// After this, find() of a remote key that was selected on its owner
+        /// returns an iterator to the local copy without communication.  Use
+        /// this for a few keys that all processes read often, such as the
+        /// top of a tree.  The replicas are not kept up to date; call
+        /// clear_replicas() on all processes before the entries change.
+        /// @param[in] select  called as \c select(key,value) on the local entries
+        /// @param[in] fence   if false the caller must fence before using the replicas
+        template <typename predT>
+        void replicate(const predT& select, bool fence=true) {
+            check_initialized();
+            p->replicate(select);
+            if (fence) p->get_world().gop.fence();
+        }
+
+        /// Discards the replicas made by replicate() (no communication)
+        void clear_replicas() {
+            check_initialized();
+            p->clear_replicas();
+        }
+
+        /// Returns a pointer to the replica of a remote key, or null if there is none (no communication)
+
+        /// Unlike find() this does not count towards replica_hits().
+        const valueT* find_replica(const keyT& key) const {
+            check_initialized();
+            return p->find_replica(key);
+        }
+
+        /// Returns the number of replicas held by this process
+        std::size_t replica_size() const {
+            check_initialized();
+            return p->replica_size();
+        }
+
+        /// Returns the number of remote finds this process answered from the replicas
+        std::size_t replica_hits() const {
+            check_initialized();
+            return p->replica_hits();
+        }
+
         /// Returns the number of \em local entries (no communication)
         std::size_t size() const {
             check_initialized();
@@ -964,7 +1143,7 @@ namespace madness {
         }
 
         /// Returns a reference to the hashing functor
-        hashfunT& get_hash() const {
+        const hashfunT& get_hash() const {
             check_initialized();
             return p->get_hash();
         }
@@ -1222,7 +1401,7 @@ namespace madness {
         task(const keyT& key, memfunT memfun, const TaskAttributes& attr = TaskAttributes()) {
             check_initialized();
             MEMFUN_RETURNT(memfunT)(implT::*itemfun)(const keyT&, memfunT) = &implT:: template itemfun<memfunT>;
-            return p->task(owner(key), itemfun, key, memfun, attr);
+            return p->task(owner(key), itemfun, key, memfun, key_affinity(key, attr));
         }
 
         /// Adds task "resultT memfun(arg1T)" in process owning item (non-blocking comm if remote)
@@ -1241,7 +1420,7 @@ namespace madness {
             check_initialized();
             typedef REMFUTURE(arg1T) a1T;
             MEMFUN_RETURNT(memfunT)(implT::*itemfun)(const keyT&, memfunT, const a1T&) = &implT:: template itemfun<memfunT,a1T>;
-            return p->task(owner(key), itemfun, key, memfun, arg1, attr);
+            return p->task(owner(key), itemfun, key, memfun, arg1, key_affinity(key, attr));
         }
 
         /// Adds task "resultT memfun(arg1T,arg2T)" in process owning item (non-blocking comm if remote)
@@ -1261,7 +1440,7 @@ namespace madness {
             typedef REMFUTURE(arg1T) a1T;
             typedef REMFUTURE(arg2T) a2T;
             MEMFUN_RETURNT(memfunT)(implT::*itemfun)(const keyT&, memfunT, const a1T&, const a2T&) = &implT:: template itemfun<memfunT,a1T,a2T>;
-            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, attr);
+            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, key_affinity(key, attr));
         }
 
         /// Adds task "resultT memfun(arg1T,arg2T,arg3T)" in process owning item (non-blocking comm if remote)
@@ -1282,7 +1461,7 @@ namespace madness {
             typedef REMFUTURE(arg2T) a2T;
             typedef REMFUTURE(arg3T) a3T;
             MEMFUN_RETURNT(memfunT)(implT::*itemfun)(const keyT&, memfunT, const a1T&, const a2T&, const a3T&) = &implT:: template itemfun<memfunT,a1T,a2T,a3T>;
-            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, arg3, attr);
+            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, arg3, key_affinity(key, attr));
         }
 
         /// Adds task "resultT memfun(arg1T,arg2T,arg3T,arg4T)" in process owning item (non-blocking comm if remote)
@@ -1304,7 +1483,7 @@ namespace madness {
             typedef REMFUTURE(arg3T) a3T;
             typedef REMFUTURE(arg4T) a4T;
             MEMFUN_RETURNT(memfunT)(implT::*itemfun)(const keyT&, memfunT, const a1T&, const a2T&, const a3T&, const a4T&) = &implT:: template itemfun<memfunT,a1T,a2T,a3T,a4T>;
-            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, arg3, arg4, attr);
+            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, arg3, arg4, key_affinity(key, attr));
         }
 
         /// Adds task "resultT memfun(arg1T,arg2T,arg3T,arg4T,arg5T)" in process owning item (non-blocking comm if remote)
@@ -1327,7 +1506,7 @@ namespace madness {
             typedef REMFUTURE(arg4T) a4T;
             typedef REMFUTURE(arg5T) a5T;
             MEMFUN_RETURNT(memfunT)(implT::*itemfun)(const keyT&, memfunT, const a1T&, const a2T&, const a3T&, const a4T&, const a5T&) = &implT:: template itemfun<memfunT,a1T,a2T,a3T,a4T,a5T>;
-            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, arg3, arg4, arg5, attr);
+            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, arg3, arg4, arg5, key_affinity(key, attr));
         }
 
         /// Adds task "resultT memfun(arg1T,arg2T,arg3T,arg4T,arg5T,arg6T)" in process owning item (non-blocking comm if remote)
@@ -1351,7 +1530,7 @@ namespace madness {
             typedef REMFUTURE(arg5T) a5T;
             typedef REMFUTURE(arg6T) a6T;
             MEMFUN_RETURNT(memfunT)(implT::*itemfun)(const keyT&, memfunT, const a1T&, const a2T&, const a3T&, const a4T&, const a5T&, const a6T&) = &implT:: template itemfun<memfunT,a1T,a2T,a3T,a4T,a5T,a6T>;
-            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, arg3, arg4, arg5, arg6, attr);
+            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, arg3, arg4, arg5, arg6, key_affinity(key, attr));
         }
 
         /// Adds task "resultT memfun(arg1T,arg2T,arg3T,arg4T,arg5T,arg6T,arg7T)" in process owning item (non-blocking comm if remote)
@@ -1376,7 +1555,7 @@ namespace madness {
             typedef REMFUTURE(arg6T) a6T;
             typedef REMFUTURE(arg7T) a7T;
             MEMFUN_RETURNT(memfunT)(implT::*itemfun)(const keyT&, memfunT, const a1T&, const a2T&, const a3T&, const a4T&, const a5T&, const a6T&, const a7T&) = &implT:: template itemfun<memfunT,a1T,a2T,a3T,a4T,a5T,a6T,a7T>;
-            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, arg3, arg4, arg5, arg6, arg7, attr);
+            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, arg3, arg4, arg5, arg6, arg7, key_affinity(key, attr));
         }
 
         /// Adds task "resultT memfun() const" in process owning item (non-blocking comm if remote)
@@ -29,6 +29,7 @@
   fax:   865-572-0680
 */
 
+#include <algorithm>
 #include <limits>
 #include <madness/world/worldgop.h>
 #include <madness/world/MADworld.h>
@@ -169,6 +170,43 @@ namespace madness {
       fence();
     }
 
+    void WorldGopInterface::make_reduce_tree() {
+        const int np = world_.size();
+        const int me = world_.rank();
+        reduce_children_.clear();
+        reduce_parent_ = -1;
+        reduce_tree_ready_ = true;
+        if (np == 1) return;
+
+        // Leader (lowest rank) of the shared-memory node of every process
+        std::vector<int> mine(np, 0), leader(np, 0);
+        {
+            SafeMPI::Intracomm node = world_.mpi.comm().Split_type(SafeMPI::Intracomm::SHARED_SPLIT_TYPE, me);
+            int l = me;
+            node.Bcast(&l, 1, MPI_INT, 0);
+            mine[me] = l;
+        }
+        world_.mpi.Allreduce(mine.data(), leader.data(), np, MPI_INT, MPI_SUM);
+
+        std::vector<ProcessID> members, leaders;
+        for (ProcessID p=0; p<np; ++p) {
+            if (leader[p] == leader[me]) members.push_back(p);
+            if (leader[p] == p) leaders.push_back(p);
+        }
+
+        // Binary tree over a sorted list of processes rooted at its first
+        auto tree = [this](const std::vector<ProcessID>& list, ProcessID p) {
+            const std::size_t i = std::find(list.begin(), list.end(), p) - list.begin();
+            for (std::size_t c=2*i+1; c<=2*i+2; ++c) {
+                if (c < list.size()) reduce_children_.push_back(list[c]);
+            }
+            return (i == 0) ? -1 : list[(i-1)/2];
+        };
+
+        reduce_parent_ = tree(members, me);
+        if (reduce_parent_ == -1) reduce_parent_ = tree(leaders, me);
+    }
+
     /// Broadcasts bytes from process root while still processing AM & tasks
 
     /// Optimizations can be added for long messages
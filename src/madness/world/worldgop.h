@@ -38,8 +38,11 @@
 /// If you can recall the Intel hypercubes, their comm lib used GOP as
 /// the abbreviation.
 
+#include <algorithm>
+#include <atomic>
 #include <functional>
 #include <type_traits>
+#include <vector>
 #include <madness/world/worldtypes.h>
 #include <madness/world/buffer_archive.h>
 #include <madness/world/world.h>
@@ -147,6 +150,15 @@ namespace madness {
         std::shared_ptr<detail::DeferredCleanup> deferred_; ///< Deferred cleanup object.
         bool debug_; ///< Debug mode
 
+        bool reduce_tree_ready_; ///< True once the reduction tree has been made
+        ProcessID reduce_parent_; ///< Parent in the reduction tree, -1 at the root
+        std::vector<ProcessID> reduce_children_; ///< Children in the reduction tree
+        std::vector<unsigned char> reduce_buffer_; ///< Receive buffer of reduce(), reused across calls
+        std::atomic<bool> reduce_buffer_busy_; ///< True while a reduction uses reduce_buffer_
+
+        /// Length in bytes of the segments in which reductions are pipelined
+        static const std::size_t reduce_segment_bytes = std::size_t(1) << 18;
+
         friend class detail::DeferredCleanup;
 
         // Message tags
@@ -613,6 +625,83 @@ namespace madness {
             return Future<result_type>::default_initializer();
         }
 
+        /// Makes the node-aware reduction tree; collective
+
+        /// The processes of a shared-memory node form a binary tree rooted at
+        /// the lowest rank of the node, and these node leaders form a binary
+        /// tree rooted at process 0.  Most messages of a reduction then stay
+        /// within a node, and each node sends a single message to its parent.
+        void make_reduce_tree();
+
+        /// Pipelined reduction along the reduction tree followed by a broadcast
+
+        /// The buffer is sent in segments of \c reduce_segment_bytes so that
+        /// each level of the tree works on one segment while the next is in
+        /// flight.  Two receive slots per child are taken from \c reduce_buffer_.
+        /// The tags must have been obtained in the same order on all processes.
+        template <typename T, class opT>
+        void reduce_impl(T* buf, std::size_t nelem, opT op, Tag up_tag, Tag down_tag) {
+            const std::size_t seg = std::max(std::size_t(1), reduce_segment_bytes/sizeof(T));
+            const std::size_t nseg = (nelem + seg - 1)/seg;
+            const std::size_t nchild = reduce_children_.size();
+            const ProcessID parent = reduce_parent_;
+            if (nseg == 0) return;
+
+            // Use the persistent buffer unless another reduction holds it
+            std::vector<unsigned char> local;
+            const std::size_t nbyte = 2*nchild*seg*sizeof(T);
+            const bool own = not reduce_buffer_busy_.exchange(true);
+            std::vector<unsigned char>& space = own ? reduce_buffer_ : local;
+            if (space.size() < nbyte) space.resize(nbyte);
+            T* slots = reinterpret_cast<T*>(space.data());
+
+            auto length = [=](std::size_t s) {return std::min(seg, nelem - s*seg);};
+            auto post = [&](std::vector<SafeMPI::Request>& req, std::size_t s) {
+                for (std::size_t c=0; c<nchild; ++c) {
+                    T* slot = slots + (2*c + s%2)*seg;
+                    req[2*c + s%2] = world_.mpi.Irecv(slot, length(s)*sizeof(T), MPI_BYTE, reduce_children_[c], up_tag);
+                }
+            };
+
+            // Reduce segment by segment towards the root
+            std::vector<SafeMPI::Request> recv(2*nchild), send;
+            for (std::size_t s=0; s<std::min(nseg,std::size_t(2)); ++s) post(recv, s);
+            for (std::size_t s=0; s<nseg; ++s) {
+                T* p = buf + s*seg;
+                const std::size_t n = length(s);
+                for (std::size_t c=0; c<nchild; ++c) {
+                    World::await(recv[2*c + s%2]);
+                    const T* q = slots + (2*c + s%2)*seg;
+                    for (std::size_t i=0; i<n; ++i) p[i] = op(p[i],q[i]);
+                }
+                if (s+2 < nseg) post(recv, s+2);
+                if (parent != -1) send.push_back(world_.mpi.Isend(p, n*sizeof(T), MPI_BYTE, parent, up_tag));
+            }
+            for (SafeMPI::Request& r : send) World::await(r);
+            if (own) reduce_buffer_busy_ = false;
+
+            // Broadcast the result segment by segment from the root
+            send.clear();
+            SafeMPI::Request precv[2];
+            if (parent != -1) {
+                for (std::size_t s=0; s<std::min(nseg,std::size_t(2)); ++s) {
+                    precv[s] = world_.mpi.Irecv(buf + s*seg, length(s)*sizeof(T), MPI_BYTE, parent, down_tag);
+                }
+            }
+            for (std::size_t s=0; s<nseg; ++s) {
+                if (parent != -1) {
+                    World::await(precv[s%2]);
+                    if (s+2 < nseg) {
+                        precv[s%2] = world_.mpi.Irecv(buf + (s+2)*seg, length(s+2)*sizeof(T), MPI_BYTE, parent, down_tag);
+                    }
+                }
+                for (ProcessID child : reduce_children_) {
+                    send.push_back(world_.mpi.Isend(buf + s*seg, length(s)*sizeof(T), MPI_BYTE, child, down_tag));
+                }
+            }
+            for (SafeMPI::Request& r : send) World::await(r);
+        }
+
         /// Implementation of fence
 
         /// \param[in] epilogue the action to execute (by the calling thread) immediately after the fence
@@ -627,7 +716,9 @@ namespace madness {
 
         // In the World constructor can ONLY rely on MPI and MPI being initialized
         WorldGopInterface(World& world) :
-            world_(world), deferred_(new detail::DeferredCleanup()), debug_(false)
+            world_(world), deferred_(new detail::DeferredCleanup()), debug_(false),
+            reduce_tree_ready_(false), reduce_parent_(-1), reduce_children_(),
+            reduce_buffer_(), reduce_buffer_busy_(false)
         { }
 
         ~WorldGopInterface() {
@@ -722,38 +813,38 @@ namespace madness {
 
         /// Inplace global reduction (like MPI all_reduce) while still processing AM & tasks
 
-        /// Optimizations can be added for long messages and to reduce the memory footprint
+        /// Reduces along a tree that keeps most messages within a
+        /// shared-memory node, and pipelines long buffers in segments.
+        /// Receive buffers are reused across calls.
         template <typename T, class opT>
         void reduce(T* buf, size_t nelem, opT op) {
-            SafeMPI::Request req0, req1;
-            ProcessID parent, child0, child1;
-            world_.mpi.binary_tree_info(0, parent, child0, child1);
-            Tag gsum_tag = world_.mpi.unique_tag();
-
-            T* buf0 = new T[nelem];
-            T* buf1 = new T[nelem];
-
-            if (child0 != -1) req0 = world_.mpi.Irecv(buf0, nelem*sizeof(T), MPI_BYTE, child0, gsum_tag);
-            if (child1 != -1) req1 = world_.mpi.Irecv(buf1, nelem*sizeof(T), MPI_BYTE, child1, gsum_tag);
-
-            if (child0 != -1) {
-                World::await(req0);
-                for (long i=0; i<(long)nelem; ++i) buf[i] = op(buf[i],buf0[i]);
-            }
-            if (child1 != -1) {
-                World::await(req1);
-                for (long i=0; i<(long)nelem; ++i) buf[i] = op(buf[i],buf1[i]);
-            }
+            if (not reduce_tree_ready_) make_reduce_tree();
+            const Tag up_tag = world_.mpi.unique_tag();
+            const Tag down_tag = world_.mpi.unique_tag();
+            reduce_impl(buf, nelem, op, up_tag, down_tag);
+        }
 
-            delete [] buf0;
-            delete [] buf1;
+        /// Global reduction that returns immediately; collective
 
-            if (parent != -1) {
-                req0 = world_.mpi.Isend(buf, nelem*sizeof(T), MPI_BYTE, parent, gsum_tag);
-                World::await(req0);
-            }
+        /// The reduction runs in a task, so the caller can overlap it with
+        /// other work.  \c buf must stay valid and must not be accessed until
+        /// the returned future is assigned; it is assigned true.  As for
+        /// reduce(), all processes must start their reductions in the same order.
+        template <typename T, class opT>
+        Future<bool> reduce_async(T* buf, size_t nelem, opT op) {
+            if (not reduce_tree_ready_) make_reduce_tree();
+            const Tag up_tag = world_.mpi.unique_tag();
+            const Tag down_tag = world_.mpi.unique_tag();
+            return world_.taskq.add([this, buf, nelem, op, up_tag, down_tag]() {
+                reduce_impl(buf, nelem, op, up_tag, down_tag);
+                return true;
+            });
+        }
 
-            broadcast(buf, nelem, 0);
+        /// Global sum that returns immediately; see reduce_async()
+        template <typename T>
+        Future<bool> sum_async(T* buf, size_t nelem) {
+            return reduce_async< T, WorldSumOp<T> >(buf, nelem, WorldSumOp<T>());
         }
 
         /// Inplace global sum while still processing AM & tasks